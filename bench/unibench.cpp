@@ -0,0 +1,526 @@
+#include <wchar.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include "unicode.h"
+#include "exceptions.h"
+
+
+/// \file unibench.cpp
+/// Micro-benchmark of UTF-8 conversion.  Current toUtf8() and fromUtf8()
+/// are compared with previous conversion through glib-style buffers,
+/// both for results and for speed.
+
+
+// Reference conversion, as unicode.cpp did it before ASCII fast path.
+
+/// Returns length of wide character in utf-8
+#define UTF8_LENGTH(Char)              \
+  ((Char) < 0x80 ? 1 :                 \
+   ((Char) < 0x800 ? 2 :               \
+    ((Char) < 0x10000 ? 3 :            \
+     ((Char) < 0x200000 ? 4 :          \
+      ((Char) < 0x4000000 ? 5 : 6)))))
+
+#define UTF8_COMPUTE(Char, Mask, Len)					      \
+  if (Char < 128)							      \
+    {									      \
+      Len = 1;								      \
+      Mask = 0x7f;							      \
+    }									      \
+  else if ((Char & 0xe0) == 0xc0)					      \
+    {									      \
+      Len = 2;								      \
+      Mask = 0x1f;							      \
+    }									      \
+  else if ((Char & 0xf0) == 0xe0)					      \
+    {									      \
+      Len = 3;								      \
+      Mask = 0x0f;							      \
+    }									      \
+  else if ((Char & 0xf8) == 0xf0)					      \
+    {									      \
+      Len = 4;								      \
+      Mask = 0x07;							      \
+    }									      \
+  else if ((Char & 0xfc) == 0xf8)					      \
+    {									      \
+      Len = 5;								      \
+      Mask = 0x03;							      \
+    }									      \
+  else if ((Char & 0xfe) == 0xfc)					      \
+    {									      \
+      Len = 6;								      \
+      Mask = 0x01;							      \
+    }									      \
+  else									      \
+    Len = -1;
+
+
+static const char utf8_skip_data[256] = {
+  1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+  1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+  1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+  1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+  1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+  1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+  2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
+  3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,4,4,4,4,4,4,4,4,5,5,5,5,6,6,1,1
+};
+
+#define g_utf8_next_char(p) (char *)((p) + utf8_skip_data[*(unsigned char *)(p)])
+
+#define UTF8_GET(Result, Chars, Count, Mask, Len)			      \
+  (Result) = (Chars)[0] & (Mask);					      \
+  for ((Count) = 1; (Count) < (Len); ++(Count))				      \
+    {									      \
+      if (((Chars)[(Count)] & 0xc0) != 0x80)				      \
+	{								      \
+	  (Result) = -1;						      \
+	  break;							      \
+	}								      \
+      (Result) <<= 6;							      \
+      (Result) |= ((Chars)[(Count)] & 0x3f);				      \
+    }
+
+/* Like g_utf8_get_char, but take a maximum length
+ * and return (wchar_t)-2 on incomplete trailing character
+ */
+static inline wchar_t
+g_utf8_get_char_extended (const  char *p,
+			  size_t max_len)  
+{
+  unsigned int i, len;
+  wchar_t wc = (unsigned char) *p;
+
+  if (wc < 0x80)
+    {
+      return wc;
+    }
+  else if (wc < 0xc0)
+    {
+      return (wchar_t)-1;
+    }
+  else if (wc < 0xe0)
+    {
+      len = 2;
+      wc &= 0x1f;
+    }
+  else if (wc < 0xf0)
+    {
+      len = 3;
+      wc &= 0x0f;
+    }
+  else if (wc < 0xf8)
+    {
+      len = 4;
+      wc &= 0x07;
+    }
+  else if (wc < 0xfc)
+    {
+      len = 5;
+      wc &= 0x03;
+    }
+  else if (wc < 0xfe)
+    {
+      len = 6;
+      wc &= 0x01;
+    }
+  else
+    {
+      return (wchar_t)-1;
+    }
+  
+  if (max_len >= 0 && len > max_len)
+    {
+      for (i = 1; i < max_len; i++)
+	{
+	  if ((((unsigned char *)p)[i] & 0xc0) != 0x80)
+	    return (wchar_t)-1;
+	}
+      return (wchar_t)-2;
+    }
+
+  for (i = 1; i < len; ++i)
+    {
+      wchar_t ch = ((unsigned char *)p)[i];
+      
+      if ((ch & 0xc0) != 0x80)
+	{
+	  if (ch)
+	    return (wchar_t)-1;
+	  else
+	    return (wchar_t)-2;
+	}
+
+      wc <<= 6;
+      wc |= (ch & 0x3f);
+    }
+
+  if (UTF8_LENGTH(wc) != len)
+    return (wchar_t)-1;
+  
+  return wc;
+}
+
+/// Decode character of valid UTF-8.
+static wchar_t
+g_utf8_get_char (const char *p)
+{
+  int i, mask = 0, len;
+  wchar_t result;
+  unsigned char c = (unsigned char) *p;
+
+  UTF8_COMPUTE (c, mask, len);
+  if (len == -1)
+    return (wchar_t)-1;
+  UTF8_GET (result, p, i, mask, len);
+
+  return result;
+}
+
+
+/// Decode UTF-8 string, result is allocated by malloc().
+static wchar_t *
+g_utf8_to_ucs4 (const char *str,
+		long        len,             
+		long       *items_read,      
+		long       *items_written,   
+		const wchar_t **error)
+{
+  wchar_t *result = NULL;
+  int n_chars, i;
+  const char *in;
+  
+  in = str;
+  n_chars = 0;
+  while ((len < 0 || str + len - in > 0) && *in)
+    {
+      wchar_t wc = g_utf8_get_char_extended (in, str + len - in);
+      if (wc & 0x80000000)
+	{
+	  if (wc == (wchar_t)-2)
+	    {
+	      if (items_read)
+		break;
+	      else
+                if (error)
+		  *error = L"Partial character sequence at end of input";
+	    }
+	  else
+            if (error)
+              *error = L"Invalid byte sequence in conversion input";
+
+	  goto err_out;
+	}
+
+      n_chars++;
+
+      in = g_utf8_next_char (in);
+    }
+
+  result = (wchar_t*)malloc((n_chars + 1) * sizeof(wchar_t));
+  
+  in = str;
+  for (i=0; i < n_chars; i++)
+    {
+      result[i] = g_utf8_get_char (in);
+      in = g_utf8_next_char (in);
+    }
+  result[i] = 0;
+
+  if (items_written)
+    *items_written = n_chars;
+
+ err_out:
+  if (items_read)
+    *items_read = in - str;
+
+  return result;
+}
+
+/// Encode character to UTF-8, returns number of bytes written.
+static int
+g_unichar_to_utf8 (wchar_t c,
+		   char   *outbuf)
+{
+  unsigned int len = 0;    
+  int first;
+  int i;
+
+  if (c < 0x80)
+    {
+      first = 0;
+      len = 1;
+    }
+  else if (c < 0x800)
+    {
+      first = 0xc0;
+      len = 2;
+    }
+  else if (c < 0x10000)
+    {
+      first = 0xe0;
+      len = 3;
+    }
+   else if (c < 0x200000)
+    {
+      first = 0xf0;
+      len = 4;
+    }
+  else if (c < 0x4000000)
+    {
+      first = 0xf8;
+      len = 5;
+    }
+  else
+    {
+      first = 0xfc;
+      len = 6;
+    }
+
+  if (outbuf)
+    {
+      for (i = len - 1; i > 0; --i)
+	{
+	  outbuf[i] = (c & 0x3f) | 0x80;
+	  c >>= 6;
+	}
+      outbuf[0] = c | first;
+    }
+
+  return len;
+}
+
+/// Encode string to UTF-8, result is allocated by malloc().
+static char *
+g_ucs4_to_utf8 (const wchar_t *str,
+		long           len,              
+		long          *items_read,       
+		long          *items_written,    
+		const wchar_t **error)
+{
+  int result_length;
+  char *result = NULL;
+  char *p;
+  int i;
+
+  result_length = 0;
+  for (i = 0; len < 0 || i < len ; i++)
+    {
+      if (!str[i])
+	break;
+
+      if ((unsigned)str[i] >= 0x80000000)
+	{
+	  if (items_read)
+	    *items_read = i;
+          if (error)
+              *error = L"Character out of range for UTF-8";
+	  goto err_out;
+	}
+      
+      result_length += UTF8_LENGTH (str[i]);
+    }
+
+  result = (char*)malloc (result_length + 1);
+  p = result;
+
+  i = 0;
+  while (p < result + result_length)
+    p += g_unichar_to_utf8 (str[i++], p);
+  
+  *p = '\0';
+
+  if (items_written)
+    *items_written = p - result;
+
+ err_out:
+  if (items_read)
+    *items_read = i;
+
+  return result;
+}
+
+static std::string oldToUtf8(const std::wstring &str)
+{
+    long readed, writed;
+    const wchar_t *errMsg = NULL;
+    
+    char *res = g_ucs4_to_utf8(str.c_str(), str.length(), &readed,
+            &writed, &errMsg);
+    if (! res) {
+        if (errMsg)
+            throw Exception(errMsg);
+        else
+            throw Exception(L"Error converting text to UTF-8");
+    }
+
+    std::string s(res);
+    free(res);
+
+    return s;
+}
+
+static std::wstring oldFromUtf8(const std::string &str)
+{
+    long readed, writed;
+    const wchar_t *errMsg = NULL;
+    
+    wchar_t *res = g_utf8_to_ucs4(str.c_str(), str.length(), &readed,
+            &writed, &errMsg);
+    if (! res) {
+        if (errMsg)
+            throw Exception(errMsg);
+        else
+            throw Exception(L"Error converting text from UTF-8");
+    }
+
+    std::wstring s(res);
+    free(res);
+    
+    return s;
+}
+
+
+/// Strings like resource and config names.
+static void genAscii(std::vector<std::string> &strings, int count)
+{
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyz"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_./";
+    srand(1);
+    for (int i = 0; i < count; i++) {
+        int len = 4 + rand() % 40;
+        std::string s;
+        for (int j = 0; j < len; j++)
+            s += chars[rand() % (sizeof(chars) - 1)];
+        strings.push_back(s);
+    }
+}
+
+/// Strings of translated messages, ASCII mixed with cyrillic.
+static void genMixed(std::vector<std::string> &strings, int count)
+{
+    srand(2);
+    for (int i = 0; i < count; i++) {
+        int len = 4 + rand() % 40;
+        std::wstring s;
+        for (int j = 0; j < len; j++)
+            s += (rand() % 3) ? (wchar_t)(0x430 + rand() % 32) : 
+                (wchar_t)(L'a' + rand() % 26);
+        strings.push_back(oldToUtf8(s));
+    }
+}
+
+
+static long long getTime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+
+/// Check that both conversions give the same results.
+static bool check(const std::vector<std::string> &strings)
+{
+    for (unsigned int i = 0; i < strings.size(); i++) {
+        std::wstring w = fromUtf8(strings[i]);
+        if ((w != oldFromUtf8(strings[i])) || (toUtf8(w) != oldToUtf8(w)))
+            return false;
+    }
+    return true;
+}
+
+/// Check that broken input is handled the same way by both conversions.
+static bool checkBroken()
+{
+    static const char *broken[] = { "abc\xff", "\xd0", "abcdefgh\xd0",
+        "\xe2\x82", "abc\x80" "def", "abcdefg\xc3(", NULL };
+    for (int i = 0; broken[i]; i++) {
+        std::wstring res, oldRes;
+        bool thrown = false, oldThrown = false;
+        try {
+            res = fromUtf8(broken[i]);
+        } catch (Exception &e) {
+            thrown = true;
+        }
+        try {
+            oldRes = oldFromUtf8(broken[i]);
+        } catch (Exception &e) {
+            oldThrown = true;
+        }
+        if ((thrown != oldThrown) || (res != oldRes))
+            return false;
+    }
+    return true;
+}
+
+
+#define ROUNDS 200
+
+static void bench(const char *name, const std::vector<std::string> &strings)
+{
+    std::vector<std::wstring> wide;
+    long long chars = 0;
+    for (unsigned int i = 0; i < strings.size(); i++) {
+        wide.push_back(fromUtf8(strings[i]));
+        chars += wide.back().length();
+    }
+    chars *= ROUNDS;
+
+    long long sum = 0;
+    long long times[4];
+    long long start = getTime();
+    for (int r = 0; r < ROUNDS; r++)
+        for (unsigned int i = 0; i < strings.size(); i++)
+            sum += oldFromUtf8(strings[i]).length();
+    times[0] = getTime() - start;
+    start = getTime();
+    for (int r = 0; r < ROUNDS; r++)
+        for (unsigned int i = 0; i < strings.size(); i++)
+            sum += fromUtf8(strings[i]).length();
+    times[1] = getTime() - start;
+    start = getTime();
+    for (int r = 0; r < ROUNDS; r++)
+        for (unsigned int i = 0; i < wide.size(); i++)
+            sum += oldToUtf8(wide[i]).length();
+    times[2] = getTime() - start;
+    start = getTime();
+    for (int r = 0; r < ROUNDS; r++)
+        for (unsigned int i = 0; i < wide.size(); i++)
+            sum += toUtf8(wide[i]).length();
+    times[3] = getTime() - start;
+
+    for (int i = 0; i < 4; i++)
+        if (! times[i])
+            times[i] = 1;
+    std::cout << name << " (" << sum << " chars converted)" << std::endl;
+    std::cout << "  fromUtf8: " << times[0] * 1000.0 / chars << " -> " << 
+        times[1] * 1000.0 / chars << " ns/char, " << 
+        (double)times[0] / times[1] << "x" << std::endl;
+    std::cout << "  toUtf8:   " << times[2] * 1000.0 / chars << " -> " << 
+        times[3] * 1000.0 / chars << " ns/char, " << 
+        (double)times[2] / times[3] << "x" << std::endl;
+}
+
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> ascii, mixed;
+    genAscii(ascii, 10000);
+    genMixed(mixed, 10000);
+
+    if ((! check(ascii)) || (! check(mixed)) || (! checkBroken())) {
+        std::cerr << "Conversion results differ" << std::endl;
+        return 1;
+    }
+
+    bench("ascii", ascii);
+    bench("mixed", mixed);
+    return 0;
+}
+
@@ -1,7 +1,6 @@
 #include "descr.h"
 
 #include <string>
-#include <list>
 #include <vector>
 #include <map>
 
@@ -22,36 +21,56 @@
 #define START_Y		100
 
 
+/// Compact layout of one page of text.  Holds only text lines and
+/// image names with their positions, widgets are created for the
+/// page being displayed only.
 class TextPage
 {
+    public:
+        typedef enum {
+            TEXT_LINE,
+            IMAGE
+        } ItemType;
+
+        typedef struct {
+            ItemType type;
+            int x, y;
+            std::wstring content;   // text of line or name of image
+        } Item;
+
     private:
-        std::vector<Widget*> widgets;
+        std::vector<Item> items;
 
     public:
         TextPage() { };
-        ~TextPage();
 
     public:
-        Widget* getWidget(int no) { return widgets[no]; };
-        int getWidgetsCount() const { return widgets.size(); };
-        void add(Widget *widget) { widgets.push_back(widget); };
-        bool isEmpty() const { return ! widgets.size(); };
+        const Item& getItem(int no) const { return items[no]; };
+        int getItemsCount() const { return items.size(); };
+        void add(ItemType type, int x, int y, const std::wstring &content);
+        bool isEmpty() const { return ! items.size(); };
 };
 
 
 class TextParser
 {
     private:
+        typedef struct {
+            int width;
+            int height;
+        } ImageSize;
+
         Tokenizer tokenizer;
         std::vector<TextPage*> pages;
         Font &font;
         int spaceWidth;
         int charHeight;
-        std::map<std::wstring, SDL_Surface*> images;
+        std::map<std::wstring, ImageSize> imageSizes;
         int offsetX;
         int offsetY;
         int pageWidth;
         int pageHeight;
+        int red, green, blue;
 
     public:
         TextParser(const std::wstring &text, Font &font,
@@ -60,6 +79,8 @@ class TextParser
 
     public:
         TextPage* getPage(unsigned int no);
+        int getPagesCount() const { return pages.size(); };
+        void createWidgets(TextPage *page, std::vector<Widget*> &widgets);
 
     private:
         void addLine(TextPage *page, std::wstring &line, int &curPosY, 
@@ -67,7 +88,7 @@ class TextParser
         void parseNextPage();
         bool isImage(const std::wstring &name);
         std::wstring keywordToImage(const std::wstring &name);
-        SDL_Surface* getImage(const std::wstring &name);
+        const ImageSize& getImageSize(const std::wstring &name);
 };
 
 
@@ -78,8 +99,8 @@ class CursorCommand;
 class Description
 {
     private:
-        typedef std::list<Widget *> WidgetsList;
-        WidgetsList widgets;
+        typedef std::vector<Widget *> WidgetsList;
+        WidgetsList widgets;            // widgets of current page
 
         CursorCommand *prevCmd;		// Sobytie na nazhatie knopki <PREV>
         CursorCommand *nextCmd;		// Sobytie na nazhatie knopki <PREV>
@@ -163,8 +184,10 @@ Description::~Description()
 void Description::deleteWidgets()
 {
     for (WidgetsList::iterator i = widgets.begin(); 
-            i != widgets.end(); i++)
+            i != widgets.end(); i++) {
         area.remove(*i);
+        delete *i;
+    }
     widgets.clear();
 }
 
@@ -194,14 +217,9 @@ void Description::printPage()
     TextPage *page = text->getPage(currentPage);
     if (! page)
         return;
-    int len = page->getWidgetsCount();
-    for (int i = 0; i < len; i++) {
-        Widget *w = page->getWidget(i);
-        if (w) {
-            widgets.push_back(w);
-            area.add(w);
-        }
-    }
+    text->createWidgets(page, widgets);
+    for (WidgetsList::iterator i = widgets.begin(); i != widgets.end(); i++)
+        area.add(*i, false);
 }
 
 CursorCommand::CursorCommand(int s, Description &d, unsigned int *v):
@@ -224,11 +242,10 @@ void CursorCommand::doAction()
 }
 
 
-TextPage::~TextPage()
+void TextPage::add(ItemType type, int x, int y, const std::wstring &content)
 {
-    for (std::vector<Widget*>::iterator i = widgets.begin();
-            i != widgets.end(); i++)
-        delete *i;
+    Item item = { type, x, y, content };
+    items.push_back(item);
 }
 
 
@@ -241,6 +258,12 @@ TextParser::TextParser(const std::wstring &text, Font &font,
     offsetY = y;
     pageWidth = width;
     pageHeight = height;
+    red = getStorage()->get(L"text_red", 0);
+    green = getStorage()->get(L"text_green", 0);
+    blue = getStorage()->get(L"text_blue", 100);
+
+    while (! tokenizer.isFinished())
+        parseNextPage();
 }
 
 
@@ -249,9 +272,6 @@ TextParser::~TextParser()
     for (std::vector<TextPage*>::iterator i = pages.begin();
             i != pages.end(); i++)
         delete *i;
-    for (std::map<std::wstring, SDL_Surface*>::iterator i = images.begin();
-            i != images.end(); i++)
-        delete (*i).second;
 }
 
 
@@ -259,11 +279,7 @@ void TextParser::addLine(TextPage *page, std::wstring &line, int &curPosY,
         int &lineWidth)
 {
     if (0 < line.length()) {
-        page->add(new Label(&font, offsetX, offsetY + curPosY,
-                    getStorage()->get(L"text_red", 0),
-                    getStorage()->get(L"text_green", 0),
-                    getStorage()->get(L"text_blue", 100),
-                    line, false));
+        page->add(TextPage::TEXT_LINE, offsetX, offsetY + curPosY, line);
         line.clear();
         curPosY += 10 + charHeight;
         lineWidth = 0;
@@ -281,14 +297,16 @@ std::wstring TextParser::keywordToImage(const std::wstring &name)
     return name.substr(1, name.length() - 2);
 }
 
-SDL_Surface* TextParser::getImage(const std::wstring &name)
+const TextParser::ImageSize& TextParser::getImageSize(const std::wstring &name)
 {
-    SDL_Surface *img = images[name];
-    if (! img) {
-        img = loadImage(name);
-        images[name] = img;
-    }
-    return img;
+    std::map<std::wstring, ImageSize>::iterator i = imageSizes.find(name);
+    if (i != imageSizes.end())
+        return (*i).second;
+
+    SDL_Surface *img = loadImage(name);
+    ImageSize size = { img->w, img->h };
+    SDL_FreeSurface(img);
+    return imageSizes[name] = size;
 }
 
 void TextParser::parseNextPage()
@@ -314,11 +332,12 @@ void TextParser::parseNextPage()
             const std::wstring &word = t.getContent();
             if (isImage(word)) {
                 addLine(page, line, curPosY, lineWidth);
-                SDL_Surface *image = getImage(keywordToImage(word));
-                if ((image->h + curPosY < pageHeight) || page->isEmpty()) {
-                    int x = offsetX + (pageWidth - image->w) / 2;
-                    page->add(new Picture(x, offsetY + curPosY, image));
-                    curPosY += image->h;
+                std::wstring name = keywordToImage(word);
+                const ImageSize &size = getImageSize(name);
+                if ((size.height + curPosY < pageHeight) || page->isEmpty()) {
+                    int x = offsetX + (pageWidth - size.width) / 2;
+                    page->add(TextPage::IMAGE, x, offsetY + curPosY, name);
+                    curPosY += size.height;
                 } else {
                     tokenizer.unget(t);
                     break;
@@ -361,11 +380,24 @@ void TextParser::parseNextPage()
 
 TextPage* TextParser::getPage(unsigned int no)
 {
-    while ((! tokenizer.isFinished()) && (pages.size() <= no))
-        parseNextPage();
     if (pages.size() <= no)
         return NULL;
     else
         return pages[no];
 }
 
+
+void TextParser::createWidgets(TextPage *page, std::vector<Widget*> &widgets)
+{
+    int len = page->getItemsCount();
+    for (int i = 0; i < len; i++) {
+        const TextPage::Item &item = page->getItem(i);
+        if (TextPage::TEXT_LINE == item.type)
+            widgets.push_back(new Label(&font, item.x, item.y, 
+                        red, green, blue, item.content, false));
+        else
+            widgets.push_back(new Picture(item.x, item.y, item.content, 
+                        false));
+    }
+}
+
@@ -0,0 +1,162 @@
+#include <math.h>
+#include <fstream>
+#include <algorithm>
+#include "fingerprint.h"
+#include "exceptions.h"
+#include "unicode.h"
+#include "utils.h"
+
+
+#define FILTER_MAGIC    0x544c4650
+#define FILTER_VERSION  1
+
+
+/// Position of thing in columns space: row * PUZZLE_SIZE + column.
+/// Labels of things don't matter after this conversion.
+static int getPlace(int thing, int cols[PUZZLE_SIZE * PUZZLE_SIZE], 
+        bool mirror)
+{
+    int col = cols[thing];
+    if (mirror)
+        col = PUZZLE_SIZE - 1 - col;
+    return (thing / PUZZLE_SIZE) * PUZZLE_SIZE + col;
+}
+
+/// Get key of rule with things replaced by their places.
+static unsigned int getPlacesKey(Rule::Info info, 
+        int cols[PUZZLE_SIZE * PUZZLE_SIZE], bool mirror)
+{
+    info.thing1 = getPlace(info.thing1, cols, mirror);
+    if (info.kind == Rule::OPEN_RULE) {
+        if (mirror)
+            info.col = PUZZLE_SIZE - 1 - info.col;
+    } else
+        info.thing2 = getPlace(info.thing2, cols, mirror);
+    if (info.kind == Rule::BETWEEN_RULE)
+        info.center = getPlace(info.center, cols, mirror);
+    if (mirror && (info.kind == Rule::DIRECTION_RULE))
+        std::swap(info.thing1, info.thing2);
+    return Rule::getRuleKey(info);
+}
+
+static unsigned long long int mix(unsigned long long int h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+void getFingerprint(SolvedPuzzle &puzzle, Rules &rules, 
+        Fingerprint &fingerprint)
+{
+    // label of thing is replaced by its column in solved puzzle
+    int cols[PUZZLE_SIZE * PUZZLE_SIZE];
+    for (int row = 0; row < PUZZLE_SIZE; row++)
+        for (int col = 0; col < PUZZLE_SIZE; col++)
+            cols[row * PUZZLE_SIZE + puzzle[row][col] - 1] = col;
+
+    std::vector<unsigned int> keys, mirrored;
+    for (Rules::iterator i = rules.begin(); i != rules.end(); i++) {
+        Rule::Info info = (*i)->getInfo();
+        keys.push_back(getPlacesKey(info, cols, false));
+        mirrored.push_back(getPlacesKey(info, cols, true));
+    }
+    std::sort(keys.begin(), keys.end());
+    std::sort(mirrored.begin(), mirrored.end());
+    if (mirrored < keys)
+        keys.swap(mirrored);
+
+    unsigned long long int h1 = 0x9e3779b97f4a7c15ULL;
+    unsigned long long int h2 = 0x6a09e667f3bcc909ULL ^ keys.size();
+    for (std::vector<unsigned int>::iterator i = keys.begin(); 
+            i != keys.end(); i++) 
+    {
+        h1 = mix(h1 ^ *i);
+        h2 = mix(h2 + *i * 0x87c37b91114253d5ULL);
+    }
+    fingerprint.high = mix(h1 + h2);
+    fingerprint.low = mix(h2 + fingerprint.high);
+}
+
+
+PuzzleFilter::PuzzleFilter(unsigned long long int expected, 
+        double errorRate)
+{
+    if (expected < 1)
+        expected = 1;
+    double ln2 = log(2.0);
+    bitsCnt = (unsigned long long int)(- (double)expected * 
+            log(errorRate) / (ln2 * ln2)) + 8;
+    hashesCnt = (int)(bitsCnt / (double)expected * ln2 + 0.5);
+    if (hashesCnt < 1)
+        hashesCnt = 1;
+    bits.resize((bitsCnt + 7) / 8);
+}
+
+PuzzleFilter::PuzzleFilter(const std::wstring &fileName)
+{
+    std::ifstream stream(toMbcs(fileName).c_str(), std::ios::in | 
+            std::ios::binary);
+    if (stream.fail())
+        throw Exception(L"Error opening " + fileName);
+    if ((readInt(stream) != FILTER_MAGIC) || 
+            (readInt(stream) != FILTER_VERSION))
+        throw Exception(L"Invalid puzzle filter " + fileName);
+    unsigned long long int high = (unsigned int)readInt(stream);
+    bitsCnt = (high << 32) | (unsigned int)readInt(stream);
+    hashesCnt = readInt(stream);
+    if ((! bitsCnt) || (hashesCnt < 1))
+        throw Exception(L"Invalid puzzle filter " + fileName);
+    bits.resize((bitsCnt + 7) / 8);
+    stream.read((char*)&bits[0], bits.size());
+    if (stream.fail())
+        throw Exception(L"Error reading " + fileName);
+}
+
+bool PuzzleFilter::add(const Fingerprint &fingerprint)
+{
+    bool added = false;
+    unsigned long long int h = fingerprint.high;
+    for (int i = 0; i < hashesCnt; i++) {
+        unsigned long long int bit = h % bitsCnt;
+        unsigned char mask = 1 << (bit % 8);
+        if (! (bits[bit / 8] & mask)) {
+            bits[bit / 8] |= mask;
+            added = true;
+        }
+        h += fingerprint.low;
+    }
+    return added;
+}
+
+bool PuzzleFilter::contains(const Fingerprint &fingerprint) const
+{
+    unsigned long long int h = fingerprint.high;
+    for (int i = 0; i < hashesCnt; i++) {
+        unsigned long long int bit = h % bitsCnt;
+        if (! (bits[bit / 8] & (1 << (bit % 8))))
+            return false;
+        h += fingerprint.low;
+    }
+    return true;
+}
+
+void PuzzleFilter::save(const std::wstring &fileName) const
+{
+    std::ofstream stream(toMbcs(fileName).c_str(), std::ios::out | 
+            std::ios::binary);
+    if (stream.fail())
+        throw Exception(L"Error creating " + fileName);
+    writeInt(stream, FILTER_MAGIC);
+    writeInt(stream, FILTER_VERSION);
+    writeInt(stream, (int)(bitsCnt >> 32));
+    writeInt(stream, (int)bitsCnt);
+    writeInt(stream, hashesCnt);
+    stream.write((const char*)&bits[0], bits.size());
+    if (stream.fail())
+        throw Exception(L"Error writing " + fileName);
+}
+
@@ -0,0 +1,68 @@
+#ifndef __FINGERPRINT_H__
+#define __FINGERPRINT_H__
+
+
+/// \file fingerprint.h
+/// Detection of equivalent puzzles
+
+
+#include <string>
+#include <vector>
+#include "puzgen.h"
+
+
+/// 128-bit fingerprint of puzzle
+typedef struct {
+    unsigned long long int high;
+    unsigned long long int low;
+} Fingerprint;
+
+
+/// Get fingerprint of puzzle.  Puzzles that differ only by order of
+/// rules, by labels of things inside rows or by mirrored columns
+/// get the same fingerprint.
+/// \param puzzle solved puzzle
+/// \param rules puzzle rules
+/// \param fingerprint calculated fingerprint
+void getFingerprint(SolvedPuzzle &puzzle, Rules &rules, 
+        Fingerprint &fingerprint);
+
+
+/// Set of fingerprints of already seen puzzles.  It is Bloom filter,
+/// so new puzzle may be taken for seen one with small probability,
+/// but seen puzzle is never taken for new one.
+class PuzzleFilter
+{
+    private:
+        std::vector<unsigned char> bits;
+        unsigned long long int bitsCnt;
+        int hashesCnt;
+
+    public:
+        /// Create empty filter.
+        /// \param expected expected number of puzzles
+        /// \param errorRate probability to take new puzzle for seen one
+        PuzzleFilter(unsigned long long int expected, double errorRate);
+
+        /// Load filter saved by save().
+        /// \param fileName name of file
+        PuzzleFilter(const std::wstring &fileName);
+
+    public:
+        /// Add puzzle to filter.
+        /// Returns true if puzzle was not seen before.
+        /// \param fingerprint fingerprint of puzzle
+        bool add(const Fingerprint &fingerprint);
+
+        /// Returns true if puzzle was probably seen.
+        /// \param fingerprint fingerprint of puzzle
+        bool contains(const Fingerprint &fingerprint) const;
+
+        /// Save filter to file.
+        /// \param fileName name of file
+        void save(const std::wstring &fileName) const;
+};
+
+
+#endif
+
@@ -1,8 +1,12 @@
+#include <wchar.h>
 #include "formatter.h"
 #include "utils.h"
 #include "convert.h"
 
 
+/// Maximum number of message arguments
+#define MAX_ARGS 16
+
 #define ADD_ARG(t) \
                 commands[commandsCnt].type = t; \
                 argNo = readInt(data + offset); \
@@ -48,6 +52,8 @@ Formatter::Formatter(unsigned char *data, int offset)
     }
 
     argsCnt = maxArg;
+    if (argsCnt > MAX_ARGS)
+        throw Exception(L"Too many arguments in message");
     if (! argsCnt)
         args = NULL;
     else {
@@ -59,10 +65,21 @@ Formatter::Formatter(unsigned char *data, int offset)
                     (c.type == FLOAT_ARG) || (c.type == DOUBLE_ARG))
             {
                 long no = (long)c.data;
+                if ((EMPTY_CMD != args[no - 1]) && (c.type != args[no - 1]))
+                    throw Exception(L"Argument " + toString(no) + 
+                            L" is used with different types");
                 args[no - 1] = c.type;
             }
         }
+        for (int i = 0; i < argsCnt; i++)
+            if (EMPTY_CMD == args[i])
+                throw Exception(L"Argument " + toString(i + 1) + 
+                        L" is not used");
     }
+    
+    for (int i = 0; i < commandsCnt; i++)
+        if (TEXT_COMMAND == commands[i].type)
+            text += *(std::wstring*)(commands[i].data);
 }
 
 Formatter::~Formatter()
@@ -76,112 +93,104 @@ Formatter::~Formatter()
         delete[] args;
 }
 
-std::wstring Formatter::getMessage() const
+bool Formatter::hasSameArgs(const Formatter &formatter) const
 {
-    std::wstring s;
-
-    for (int i = 0; i < commandsCnt; i++)
-        if (TEXT_COMMAND == commands[i].type)
-            s += *(std::wstring*)(commands[i].data);
-    return s;
+    if (argsCnt != formatter.argsCnt)
+        return false;
+    for (int i = 0; i < argsCnt; i++)
+        if (args[i] != formatter.args[i])
+            return false;
+    return true;
 }
 
 
-class ArgValue
+static void appendInt(std::wstring &s, int value)
 {
-    public:
-        virtual ~ArgValue() { };
-        virtual std::wstring format(Formatter::Command *command) = 0;
-};
+    wchar_t buf[16];
+    wchar_t *p = buf + 16;
+    unsigned int v = (value < 0) ? - (unsigned int)value : value;
+    do {
+        *--p = L'0' + v % 10;
+        v /= 10;
+    } while (v);
+    if (value < 0)
+        *--p = L'-';
+    s.append(p, buf + 16 - p);
+}
 
-template <typename T>
-class TemplatedArgValue: public ArgValue
-{
-    private:
-        T value;
-    
-    public:
-        TemplatedArgValue(const T &v) { value = v; };
-        virtual std::wstring format(Formatter::Command *command) { 
-            return toString(value);
-        };
-};
-
-class StrArgValue: public ArgValue
+static void appendDouble(std::wstring &s, double value)
 {
-    private:
-        std::wstring value;
+    wchar_t buf[50];
+#ifdef WIN32
+    swprintf(buf, L"%g", value);
+#else
+    swprintf(buf, 50, L"%g", value);
+#endif
+    s += buf;
+}
 
-    public:
-        StrArgValue(const std::wstring &v): value(v) { };
-        virtual std::wstring format(Formatter::Command *command) { 
-            return value;
-        };
-};
 
+/// Value of message argument
+typedef union {
+    int intValue;
+    double doubleValue;
+    const wchar_t *strValue;
+} ArgValue;
 
-std::wstring Formatter::format(std::vector<ArgValue*> &argValues) const
-{
-    std::wstring s;
-    long no;
 
-    for (int i = 0; i < commandsCnt; i++) {
-        Command *cmd = &commands[i];
-
-        switch (cmd->type) {
-            case TEXT_COMMAND:
-                s += *(std::wstring*)(cmd->data);
+void Formatter::format(std::wstring &s, va_list ap) const
+{
+    if (! argsCnt) {
+        s += text;
+        return;
+    }
+    
+    ArgValue values[MAX_ARGS];
+    for (int i = 0; i < argsCnt; i++) {
+        switch (args[i]) {
+            case INT_ARG:
+                values[i].intValue = va_arg(ap, int);
                 break;
-                
             case STRING_ARG:
-            case INT_ARG:
-                no = (long)cmd->data - 1;
-                if (no < (long)argValues.size())
-                    s += argValues[no]->format(cmd);
+                values[i].strValue = va_arg(ap, wchar_t*);
+                break;
+            case DOUBLE_ARG:
+                values[i].doubleValue = va_arg(ap, double);
+                break;
+            case FLOAT_ARG:
+                values[i].doubleValue = (float)va_arg(ap, double);
                 break;
-
             default: ;
         }
     }
-    
-    return s;
-}
+ 
+    for (int i = 0; i < commandsCnt; i++) {
+        Command *cmd = &commands[i];
+        long no = (long)cmd->data - 1;
 
-std::wstring Formatter::format(va_list ap) const
-{
-    if (! argsCnt)
-        return getMessage();
-    
-    std::vector<ArgValue*> argValues;
-    
-    for (int i = 0; i < argsCnt; i++) {
-        switch (args[i]) {
+        switch (cmd->type) {
+            case TEXT_COMMAND:
+                s += *(std::wstring*)(cmd->data);
+                break;
             case INT_ARG:
-                argValues.push_back(new TemplatedArgValue<int>
-                        (va_arg(ap, int))); 
+                appendInt(s, values[no].intValue);
                 break;
             case STRING_ARG:
-                argValues.push_back(new StrArgValue(va_arg(ap, wchar_t*)));
+                s += values[no].strValue;
                 break;
             case DOUBLE_ARG:
-                argValues.push_back(new TemplatedArgValue<double>
-                        (va_arg(ap, double)));
-                break;
             case FLOAT_ARG:
-                argValues.push_back(new TemplatedArgValue<float>
-                        ((float)va_arg(ap, double)));
+                appendDouble(s, values[no].doubleValue);
                 break;
-            default:
-                i = argsCnt;
+            default: ;
         }
     }
- 
-    std::wstring s = format(argValues);
+}
 
-    for (std::vector<ArgValue*>::iterator i = argValues.begin();
-            i != argValues.end(); i++)
-        delete *i;
-    
+std::wstring Formatter::format(va_list ap) const
+{
+    std::wstring s;
+    format(s, ap);
     return s;
 }
 
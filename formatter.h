@@ -4,10 +4,6 @@
 
 #include <stdarg.h>
 #include <string>
-#include <vector>
-
-
-class ArgValue;
 
 
 /// Localized message formatter
@@ -37,6 +33,9 @@ class Formatter
         
         CmdType *args;
 
+        /// Message text without arguments
+        std::wstring text;
+
     public:
         /// Create localized message from message buffer.
         /// \param data buffer contained message file
@@ -46,14 +45,20 @@ class Formatter
 
     public:
         /// Get message text.
-        std::wstring getMessage() const;
+        const std::wstring& getMessage() const { return text; };
         
         /// Fromat message
         /// \param ap list of arguments
         std::wstring format(va_list ap) const;
 
-    private:
-        std::wstring format(std::vector<ArgValue*> &argValues) const;
+        /// Format message and append it to string.
+        /// \param result string where formatted message will be appended
+        /// \param ap list of arguments
+        void format(std::wstring &result, va_list ap) const;
+
+        /// Check if other message takes the same arguments.
+        /// \param formatter other message
+        bool hasSameArgs(const Formatter &formatter) const;
 };
 
 
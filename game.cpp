@@ -1,4 +1,7 @@
+#include <sstream>
+#include <zlib.h>
 #include "main.h"
+#include "exceptions.h"
 #include "utils.h"
 #include "widgets.h"
 #include "puzzle.h"
@@ -13,17 +16,18 @@
 #include "messages.h"
 #include "sound.h"
 #include "descr.h"
+#include "storage.h"
 
 
 
-class GameBackground: public Widget
+class GameBackground: public StaticLayer
 {
-    public:
-        virtual void draw();
+    protected:
+        virtual void render();
 };
 
 
-void GameBackground::draw()
+void GameBackground::render()
 {
     // draw background
     drawWallpaper(L"rain.bmp");
@@ -36,8 +40,6 @@ void GameBackground::draw()
     Font titleFont(L"nova.ttf", 28);
     titleFont.draw(screen.getSurface(), 20, 20, 255,255,0, true, 
             msg(L"einsteinPuzzle"));
-    
-    screen.addRegionToUpdate(0, 0, screen.getWidth(), screen.getHeight());
 }
 
 
@@ -176,6 +178,7 @@ class PauseGameCommand: public Command
         
         virtual void doAction() {
             watch->stop();
+            ScreenSnapshot snapshot;
             Area area;
             area.add(background, false);
             Font font(L"laudcn2.ttf", 16);
@@ -185,8 +188,8 @@ class PauseGameCommand: public Command
             area.add(new AnyKeyAccel());
             area.run();
             sound->play(L"click.wav");
+            snapshot.restore();
             gameArea->updateMouse();
-            gameArea->draw();
             watch->start();
         };
 };
@@ -330,10 +333,11 @@ class CheatCommand: public Command
         
         virtual void doAction() {
             Font font(L"nova.ttf", 30);
+            ScreenSnapshot snapshot;
             showMessageWindow(gameArea, L"darkpattern.bmp", 
                     500, 100, &font, 255,255,255, 
                     msg(L"iddqd"));
-            gameArea->draw();
+            snapshot.restore();
         };
 };
 
@@ -357,12 +361,13 @@ class SaveGameCommand: public Command
         virtual void doAction() {
             watch->stop();
 
+            ScreenSnapshot snapshot;
             Area area;
             area.add(background, false);
             saveGame(&area, game);
             
+            snapshot.restore();
             gameArea->updateMouse();
-            gameArea->draw();
             watch->start();
         };
 };
@@ -379,9 +384,10 @@ class GameOptionsCommand: public Command
         };
         
         virtual void doAction() {
+            ScreenSnapshot snapshot;
             showOptionsWindow(gameArea);
+            snapshot.restore();
             gameArea->updateMouse();
-            gameArea->draw();
         };
 };
 
@@ -402,22 +408,41 @@ class HelpCommand: public Command
         
         virtual void doAction() {
             watch->stop();
+            ScreenSnapshot snapshot;
             Area area;
             area.add(background, false);
             area.draw();
             showDescription(&area);
+            snapshot.restore();
             gameArea->updateMouse();
-            gameArea->draw();
             watch->start();
         };
 };
 
 
 
+/// Get ID for new puzzle.  Generator uses pairs and triples
+/// if "subsets" storage key is set.
+static PuzzleId genNewPuzzleId()
+{
+    return genPuzzleId(getStorage()->get(L"subsets", 0) != 0);
+}
+
+
 Game::Game()
 {
-    genPuzzle();
+    genPuzzle(genNewPuzzleId());
+    init();
+}
 
+Game::Game(PuzzleId id)
+{
+    genPuzzle(id);
+    init();
+}
+
+void Game::init()
+{
     possibilities = new Possibilities();
     openInitial(*possibilities, rules);
     
@@ -427,15 +452,53 @@ Game::Game()
     watch = new Watch();
 }
 
+/// First integer of save in current format.  Old saves start with
+/// puzzle element so they never match it.
+#define SAVE_MAGIC      0x56415345
+#define SAVE_VERSION    2
+
+
 Game::Game(std::istream &stream)
 {
     pleaseWait();
 
+    std::istream::pos_type start = stream.tellg();
+    if (readInt(stream) != SAVE_MAGIC) {
+        stream.seekg(start);
+        load(stream, false);
+        return;
+    }
+
+    int version = readInt(stream);
+    int size = readInt(stream);
+    unsigned int checksum = readInt(stream);
+    if (version != SAVE_VERSION)
+        throw Exception(L"Unsupported save version");
+    if (size <= 0)
+        throw Exception(L"Invalid save size");
+    std::string data(size, 0);
+    stream.read(&data[0], size);
+    if (stream.fail())
+        throw Exception(L"Error reading save");
+    if (adler32(adler32(0L, Z_NULL, 0), (const Bytef*)data.data(), size) != 
+            checksum)
+        throw Exception(L"Save is corrupted");
+
+    std::istringstream dataStream(data, std::ios::in | std::ios::binary);
+    load(dataStream, true);
+}
+
+void Game::load(std::istream &stream, bool packed)
+{
     loadPuzzle(solvedPuzzle, stream);
     loadRules(rules, stream);
     memcpy(savedSolvedPuzzle, solvedPuzzle, sizeof(solvedPuzzle));
     savedRules = rules;
-    possibilities = new Possibilities(stream);
+    if (packed) {
+        possibilities = new Possibilities();
+        possibilities->loadPacked(stream);
+    } else
+        possibilities = new Possibilities(stream);
     puzzle = new Puzzle(iconSet, solvedPuzzle, possibilities);
     verHints = new VertHints(iconSet, rules, stream);
     horHints = new HorHints(iconSet, rules, stream);
@@ -455,12 +518,29 @@ Game::~Game()
 
 void Game::save(std::ostream &stream)
 {
-    savePuzzle(solvedPuzzle, stream);
-    saveRules(rules, stream);
-    possibilities->save(stream);
-    verHints->save(stream);
-    horHints->save(stream);
-    watch->save(stream);
+    std::ostringstream dataStream(std::ios::out | std::ios::binary);
+    savePuzzle(solvedPuzzle, dataStream);
+    saveRules(rules, dataStream);
+    possibilities->savePacked(dataStream);
+    verHints->save(dataStream);
+    horHints->save(dataStream);
+    watch->save(dataStream);
+    std::string data(dataStream.str());
+
+    std::ostringstream header(std::ios::out | std::ios::binary);
+    writeInt(header, SAVE_MAGIC);
+    writeInt(header, SAVE_VERSION);
+    writeInt(header, data.length());
+    writeInt(header, adler32(adler32(0L, Z_NULL, 0), 
+                (const Bytef*)data.data(), data.length()));
+    
+    std::string buf(header.str() + data);
+    stream.write(buf.data(), buf.length());
+}
+
+int Game::getElapsed()
+{
+    return watch->getElapsed();
 }
 
 void Game::deleteRules()
@@ -483,17 +563,12 @@ void Game::pleaseWait()
     screen.flush();
 }
 
-void Game::genPuzzle()
+void Game::genPuzzle(PuzzleId id)
 {
     pleaseWait();
     
-    int horRules, verRules;
-    do {
-        if (rules.size() > 0)
-            deleteRules();
-        ::genPuzzle(solvedPuzzle, rules);
-        getHintsQty(rules, verRules, horRules);
-    } while ((horRules > 24) || (verRules > 15));
+    deleteRules();
+    ::genPuzzle(solvedPuzzle, rules, id);
 
     memcpy(savedSolvedPuzzle, solvedPuzzle, sizeof(solvedPuzzle));
     savedRules = rules;
@@ -513,7 +588,7 @@ void Game::resetVisuals()
 
 void Game::newGame()
 {
-    genPuzzle();
+    genPuzzle(genNewPuzzleId());
     resetVisuals();
 }
 
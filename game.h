@@ -31,6 +31,7 @@ class Game
 
     public:
         Game();
+        Game(PuzzleId id);
         Game(std::istream &stream);
         ~Game();
 
@@ -40,6 +41,7 @@ class Game
         Possibilities* getPossibilities() { return possibilities; };
         VertHints* getVerHints() { return verHints; };
         HorHints* getHorHints() { return horHints; };
+        int getElapsed();
         void save(std::ostream &stream);
         void run();
         bool isHinted() { return hinted; };
@@ -50,8 +52,10 @@ class Game
     private:
         void deleteRules();
         void pleaseWait();
-        void genPuzzle();
+        void load(std::istream &stream, bool packed);
+        void genPuzzle(PuzzleId id);
         void resetVisuals();
+        void init();
 };
 
 #endif
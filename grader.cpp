@@ -0,0 +1,36 @@
+#include <string.h>
+#include "grader.h"
+#include "solver.h"
+#include "instrument.h"
+
+
+void gradePuzzle(Rules &rules, Difficulty &difficulty, bool subsets)
+{
+    INSTR_SPAN("gradePuzzle");
+    memset(&difficulty, 0, sizeof(Difficulty));
+    difficulty.rulesCnt = rules.size();
+
+    Possibilities pos;
+    pos.setSubsets(subsets);
+    int possible = pos.countPossible();
+    bool changed;
+    
+    do {
+        changed = false;
+        for (Rules::iterator i = rules.begin(); i != rules.end(); i++) {
+            Rule *rule = *i;
+            if (rule->apply(pos)) {
+                changed = true;
+                int cnt = pos.countPossible();
+                difficulty.deductions[rule->getInfo().kind] += possible - cnt;
+                possible = cnt;
+            }
+        }
+        difficulty.rounds++;
+    } while (changed);
+
+    difficulty.solved = pos.isSolved();
+    difficulty.cascadeDepth = pos.getMaxCascade();
+    propagateRules(rules, &difficulty.chainLength);
+}
+
@@ -0,0 +1,34 @@
+#ifndef __GRADER_H__
+#define __GRADER_H__
+
+
+/// \file grader.h
+/// Measuring of puzzle difficulty
+
+
+#include "puzgen.h"
+
+
+/// Difficulty of puzzle measured by replaying rules propagation
+typedef struct {
+    bool solved;                    /// true if propagation solves puzzle
+    int rulesCnt;                   /// number of rules
+    int rounds;                     /// passes over rules list
+    int deductions[RULE_KINDS_CNT]; /// possibilities excluded by each 
+                                    /// rule kind, indexed by Rule::Kind
+    int cascadeDepth;               /// deepest cascade of single checks
+    int chainLength;                /// longest chain of dependent 
+                                    /// deductions
+} Difficulty;
+
+
+/// Measure difficulty of puzzle.
+/// \param rules puzzle rules
+/// \param difficulty measured difficulty
+/// \param subsets propagate pairs and triples as generator did, 
+/// chain length always counts single checks only
+void gradePuzzle(Rules &rules, Difficulty &difficulty, bool subsets=false);
+
+
+#endif
+
@@ -93,7 +93,7 @@ void HorHints::drawCell(int col, int row, bool addToUpdate)
         r->draw(x, y, iconSet, no == highlighted);
     else
         for (int i = 0; i < 3; i++)
-            screen.draw(x + TILE_HEIGHT*i, y, iconSet.getEmptyHintIcon());
+            iconSet.draw(x + TILE_HEIGHT*i, y, iconSet.getEmptyHintIcon());
     
     if (addToUpdate)
         screen.addRegionToUpdate(x, y, TILE_WIDTH*3, TILE_HEIGHT);
@@ -185,6 +185,15 @@ int HorHints::getRuleNo(int x, int y)
     return no;
 }
 
+bool HorHints::getBounds(int &left, int &top, int &width, int &height)
+{
+    left = TILE_X;
+    top = TILE_Y;
+    width = (TILE_WIDTH*3 + TILE_GAP_X) * HINTS_COLS;
+    height = (TILE_HEIGHT + TILE_GAP_Y) * HINTS_ROWS;
+    return true;
+}
+
 bool HorHints::isActive(int ruleNo)
 {
     if ((ruleNo < 0) || (ruleNo >= (int)rules.size()))
@@ -1,57 +1,148 @@
 #include <string.h>
+#include <vector>
 #include "iconset.h"
 #include "utils.h"
+#include "main.h"
+
+
+#define ATLAS_WIDTH 576
+
+
+typedef struct {
+    SDL_Surface *image;
+    SDL_Rect *rect;
+} AtlasEntry;
+
+typedef std::vector<AtlasEntry> AtlasEntries;
+
+
+static void addToAtlas(AtlasEntries &entries, SDL_Surface *image, 
+        SDL_Rect &rect)
+{
+    AtlasEntry e = { image, &rect };
+    entries.push_back(e);
+}
+
+
+/// Place images on shelves of atlas and copy them to atlas surface.
+/// Source images are freed.
+static SDL_Surface* buildAtlas(AtlasEntries &entries)
+{
+    int x = 0, y = 0, shelfHeight = 0;
+    for (AtlasEntries::iterator i = entries.begin(); i != entries.end(); i++) {
+        SDL_Surface *image = (*i).image;
+        if (x + image->w > ATLAS_WIDTH) {
+            x = 0;
+            y += shelfHeight;
+            shelfHeight = 0;
+        }
+        SDL_Rect r = { x, y, image->w, image->h };
+        *(*i).rect = r;
+        x += image->w;
+        if (image->h > shelfHeight)
+            shelfHeight = image->h;
+    }
+
+    SDL_PixelFormat *f = entries.front().image->format;
+    SDL_Surface *s = SDL_CreateRGBSurface(SDL_SWSURFACE, ATLAS_WIDTH, 
+            y + shelfHeight, f->BitsPerPixel, f->Rmask, f->Gmask, 
+            f->Bmask, f->Amask);
+    if (! s)
+        throw Exception(L"Error creating icons atlas");
+    SDL_Surface *atlas = SDL_DisplayFormat(s);
+    SDL_FreeSurface(s);
+    if (! atlas)
+        throw Exception(L"Error converting icons atlas to display format");
+    
+    for (AtlasEntries::iterator i = entries.begin(); i != entries.end(); i++) {
+        SDL_Surface *image = (*i).image;
+        SDL_Rect src = { 0, 0, image->w, image->h };
+        SDL_Rect dst = *(*i).rect;
+        SDL_BlitSurface(image, &src, atlas, &dst);
+        SDL_FreeSurface(image);
+    }
+    return atlas;
+}
 
 
 IconSet::IconSet()
 {
+    AtlasEntries entries;
+    std::vector<SDL_Surface*> smallImages;
     std::wstring buf = L"xy.bmp";
     
     for (int i = 0; i < 6; i++)
         for (int j = 0; j < 6; j++) {
             buf[1] = L'1' + j;
-            buf[0] = L'a' + i;
-            smallIcons[i][j][0] = loadImage(buf);
-            smallIcons[i][j][1] = adjustBrightness(smallIcons[i][j][0], 1.5, false);
             buf[0] = L'A' + i;
-            largeIcons[i][j][0] = loadImage(buf);
-            largeIcons[i][j][1] = adjustBrightness(largeIcons[i][j][0], 1.5, false);
+            SDL_Surface *icon = loadImage(buf);
+            addToAtlas(entries, icon, largeIcons[i][j][0]);
+            addToAtlas(entries, adjustBrightness(icon, 1.5, false),
+                    largeIcons[i][j][1]);
+        }
+    SDL_Surface *icon = loadImage(L"tile.bmp");
+    addToAtlas(entries, icon, emptyFieldIcon);
+    icon = loadImage(L"hint-tile.bmp");
+    addToAtlas(entries, icon, emptyHintIcon);
+    icon = loadImage(L"hint-near.bmp");
+    addToAtlas(entries, icon, nearHintIcon[0]);
+    addToAtlas(entries, adjustBrightness(icon, 1.5, false), nearHintIcon[1]);
+    icon = loadImage(L"hint-side.bmp");
+    addToAtlas(entries, icon, sideHintIcon[0]);
+    addToAtlas(entries, adjustBrightness(icon, 1.5, false), sideHintIcon[1]);
+    for (int i = 0; i < 6; i++)
+        for (int j = 0; j < 6; j++) {
+            buf[1] = L'1' + j;
+            buf[0] = L'a' + i;
+            icon = loadImage(buf);
+            addToAtlas(entries, icon, smallIcons[i][j][0]);
+            addToAtlas(entries, adjustBrightness(icon, 1.5, false),
+                    smallIcons[i][j][1]);
         }
-    emptyFieldIcon = loadImage(L"tile.bmp");
-    emptyHintIcon = loadImage(L"hint-tile.bmp");
-    nearHintIcon[0] = loadImage(L"hint-near.bmp");
-    nearHintIcon[1] = adjustBrightness(nearHintIcon[0], 1.5, false);
-    sideHintIcon[0] = loadImage(L"hint-side.bmp");
-    sideHintIcon[1] = adjustBrightness(sideHintIcon[0], 1.5, false);
+    atlas = buildAtlas(entries);
+
     betweenArrow[0] = loadImage(L"betwarr.bmp", true);
     betweenArrow[1] = adjustBrightness(betweenArrow[0], 1.5, false);
 }
 
 IconSet::~IconSet()
 {
-    for (int i = 0; i < 6; i++)
-        for (int j = 0; j < 6; j++)
-            for (int k = 0; k < 2; k++) {
-                SDL_FreeSurface(smallIcons[i][j][k]);
-                SDL_FreeSurface(largeIcons[i][j][k]);
-            }
-    SDL_FreeSurface(emptyFieldIcon);
-    SDL_FreeSurface(emptyHintIcon);
-    SDL_FreeSurface(nearHintIcon[0]);
-    SDL_FreeSurface(nearHintIcon[1]);
-    SDL_FreeSurface(sideHintIcon[0]);
-    SDL_FreeSurface(sideHintIcon[1]);
+    SDL_FreeSurface(atlas);
     SDL_FreeSurface(betweenArrow[0]);
     SDL_FreeSurface(betweenArrow[1]);
 }
 
-SDL_Surface* IconSet::getLargeIcon(int row, int num, bool h)
+const SDL_Rect& IconSet::getLargeIcon(int row, int num, bool h)
 {
     return largeIcons[row][num-1][h ? 1 : 0];
 }
 
-SDL_Surface* IconSet::getSmallIcon(int row, int num, bool h)
+const SDL_Rect& IconSet::getSmallIcon(int row, int num, bool h)
 {
     return smallIcons[row][num-1][h ? 1 : 0];
 }
 
+void IconSet::draw(int x, int y, const SDL_Rect &icon)
+{
+    Blit b = { &icon, x, y };
+    drawBatch(&b, 1);
+}
+
+void IconSet::drawBatch(const Blit *blits, int count)
+{
+    SDL_Surface *s = screen.getSurface();
+    const SDL_Rect &clip = s->clip_rect;
+    
+    for (int i = 0; i < count; i++) {
+        SDL_Rect src = *blits[i].icon;
+        SDL_Rect dst = { blits[i].x, blits[i].y, src.w, src.h };
+        // icons inside clip rectangle don't need clipping
+        if ((dst.x >= clip.x) && (dst.y >= clip.y) &&
+                (dst.x + src.w <= clip.x + clip.w) &&
+                (dst.y + src.h <= clip.y + clip.h))
+            SDL_LowerBlit(atlas, &src, s, &dst);
+        else
+            SDL_BlitSurface(atlas, &src, s, &dst);
+    }
+}
+
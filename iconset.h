@@ -5,26 +5,45 @@
 #include <SDL/SDL.h>
 
 
+/// Game icons packed into single atlas surface.
+/// Icons are referenced by their rectangles inside atlas.
 class IconSet
 {
+    public:
+        /// Single icon blit in batch.
+        typedef struct {
+            const SDL_Rect *icon;
+            int x, y;
+        } Blit;
+
     private:
-        SDL_Surface *smallIcons[6][6][2];
-        SDL_Surface *largeIcons[6][6][2];
-        SDL_Surface *emptyFieldIcon, *emptyHintIcon, *nearHintIcon[2];
-        SDL_Surface *sideHintIcon[2], *betweenArrow[2];
+        SDL_Surface *atlas;
+        SDL_Rect smallIcons[6][6][2];
+        SDL_Rect largeIcons[6][6][2];
+        SDL_Rect emptyFieldIcon, emptyHintIcon, nearHintIcon[2];
+        SDL_Rect sideHintIcon[2];
+        SDL_Surface *betweenArrow[2];
     
     public:
         IconSet();
         virtual ~IconSet();
 
     public:
-        SDL_Surface* getLargeIcon(int row, int num, bool highlighted);
-        SDL_Surface* getSmallIcon(int row, int num, bool highlighted);
-        SDL_Surface* getEmptyFieldIcon() { return emptyFieldIcon; };
-        SDL_Surface* getEmptyHintIcon() { return emptyHintIcon; };
-        SDL_Surface* getNearHintIcon(bool h) { return nearHintIcon[h ? 1 : 0]; };
-        SDL_Surface* getSideHintIcon(bool h) { return sideHintIcon[h ? 1 : 0]; };
+        const SDL_Rect& getLargeIcon(int row, int num, bool highlighted);
+        const SDL_Rect& getSmallIcon(int row, int num, bool highlighted);
+        const SDL_Rect& getEmptyFieldIcon() { return emptyFieldIcon; };
+        const SDL_Rect& getEmptyHintIcon() { return emptyHintIcon; };
+        const SDL_Rect& getNearHintIcon(bool h) { return nearHintIcon[h ? 1 : 0]; };
+        const SDL_Rect& getSideHintIcon(bool h) { return sideHintIcon[h ? 1 : 0]; };
+        
+        /// Arrow is transparent so it is not placed in atlas.
         SDL_Surface* getBetweenArrow(bool h) { return betweenArrow[h ? 1 : 0]; };
+
+        /// Draw icon on screen.
+        void draw(int x, int y, const SDL_Rect &icon);
+
+        /// Draw number of icons on screen.
+        void drawBatch(const Blit *blits, int count);
 };
 
 
@@ -0,0 +1,174 @@
+#ifdef INSTRUMENT
+
+#include <string.h>
+#include <vector>
+#include <fstream>
+#include "instrument.h"
+#include "utils.h"
+#include "unicode.h"
+#include "exceptions.h"
+
+
+/// Trace keeps only first events so long runs don't eat all memory.
+#define MAX_TRACE_EVENTS    200000
+#define MAX_PASSES          32
+#define MAX_CASCADE         16
+
+
+/// Complete event of trace.
+typedef struct {
+    const char *name;
+    long long start;
+    long long duration;
+} TraceEvent;
+
+/// Applications of rules of one kind.
+typedef struct {
+    long long applied;
+    long long useful;           /// applications that changed something
+    long long usecs;
+} KindStats;
+
+
+static const char *kindNames[RULE_KINDS_CNT] = { "near", "direction",
+    "open", "under", "between" };
+
+static std::vector<TraceEvent> events;
+static long long droppedEvents = 0;
+static long long origin = -1;
+static KindStats kinds[RULE_KINDS_CNT];
+static long long solveCalls = 0;
+static long long solvedCnt = 0;
+static long long passesCnt[MAX_PASSES + 1];
+static long long cascades[MAX_CASCADE + 1];
+
+
+/// Microseconds since first call.  Resolution is 1 ms on Windows.
+static long long getTime()
+{
+    struct timeval tv;
+    gettimeofday(&tv);
+    long long now = (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+    if (origin < 0)
+        origin = now;
+    return now - origin;
+}
+
+
+InstrSpan::InstrSpan(const char *n)
+{
+    name = n;
+    start = getTime();
+}
+
+InstrSpan::~InstrSpan()
+{
+    if (events.size() >= MAX_TRACE_EVENTS) {
+        droppedEvents++;
+        return;
+    }
+    TraceEvent event;
+    event.name = name;
+    event.start = start;
+    event.duration = getTime() - start;
+    events.push_back(event);
+}
+
+
+bool instrApplyRule(Rule *rule, Possibilities &pos)
+{
+    KindStats &stats = kinds[rule->getInfo().kind];
+    long long start = getTime();
+    bool res = rule->apply(pos);
+    stats.usecs += getTime() - start;
+    stats.applied++;
+    if (res)
+        stats.useful++;
+    return res;
+}
+
+void instrSolved(int passes, bool solved)
+{
+    solveCalls++;
+    if (solved)
+        solvedCnt++;
+    passesCnt[passes < MAX_PASSES ? passes : MAX_PASSES]++;
+}
+
+void instrCascade(int depth)
+{
+    cascades[depth < MAX_CASCADE ? depth : MAX_CASCADE]++;
+}
+
+void instrReset()
+{
+    events.clear();
+    droppedEvents = 0;
+    origin = -1;
+    memset(kinds, 0, sizeof(kinds));
+    solveCalls = solvedCnt = 0;
+    memset(passesCnt, 0, sizeof(passesCnt));
+    memset(cascades, 0, sizeof(cascades));
+}
+
+
+static void writeHistogram(std::ostream &stream, long long *counts,
+        int size)
+{
+    stream << "[";
+    for (int i = 0; i <= size; i++)
+        stream << (i ? "," : "") << counts[i];
+    stream << "]";
+}
+
+void instrSaveTrace(const std::wstring &fileName)
+{
+    std::ofstream stream(toMbcs(fileName).c_str(), std::ios::out);
+    if (! stream.good())
+        throw Exception(L"Error creating trace file");
+
+    long long end = getTime();
+
+    stream << "{\"traceEvents\":[" << std::endl;
+    for (std::vector<TraceEvent>::iterator i = events.begin();
+            i != events.end(); i++)
+        stream << "{\"name\":\"" << i->name << "\",\"ph\":\"X\",\"ts\":" <<
+            i->start << ",\"dur\":" << i->duration <<
+            ",\"pid\":1,\"tid\":1}," << std::endl;
+
+    // totals as counters at the end of trace
+    stream << "{\"name\":\"applied\",\"ph\":\"C\",\"ts\":" << end <<
+        ",\"pid\":1,\"args\":{";
+    for (int i = 0; i < RULE_KINDS_CNT; i++)
+        stream << (i ? "," : "") << "\"" << kindNames[i] << "\":" <<
+            kinds[i].applied;
+    stream << "}}," << std::endl;
+    stream << "{\"name\":\"useful\",\"ph\":\"C\",\"ts\":" << end <<
+        ",\"pid\":1,\"args\":{";
+    for (int i = 0; i < RULE_KINDS_CNT; i++)
+        stream << (i ? "," : "") << "\"" << kindNames[i] << "\":" <<
+            kinds[i].useful;
+    stream << "}}" << std::endl << "]," << std::endl;
+
+    stream << "\"displayTimeUnit\":\"ms\"," << std::endl;
+    stream << "\"otherData\":{" << std::endl;
+    for (int i = 0; i < RULE_KINDS_CNT; i++)
+        stream << "\"" << kindNames[i] << "\":{\"applied\":" <<
+            kinds[i].applied << ",\"useful\":" << kinds[i].useful <<
+            ",\"wasted\":" << kinds[i].applied - kinds[i].useful <<
+            ",\"usecs\":" << kinds[i].usecs << "}," << std::endl;
+    stream << "\"solveCalls\":" << solveCalls << ",\"solved\":" <<
+        solvedCnt << "," << std::endl << "\"passes\":";
+    writeHistogram(stream, passesCnt, MAX_PASSES);
+    stream << "," << std::endl << "\"cascades\":";
+    writeHistogram(stream, cascades, MAX_CASCADE);
+    stream << "," << std::endl << "\"droppedEvents\":" << droppedEvents <<
+        std::endl << "}}" << std::endl;
+
+    if (! stream.good())
+        throw Exception(L"Error writing trace file");
+}
+
+
+#endif
+
@@ -0,0 +1,63 @@
+#ifndef __INSTRUMENT_H__
+#define __INSTRUMENT_H__
+
+
+/// \file instrument.h
+/// Counters and trace of puzzle generator.  Compiled in only when
+/// INSTRUMENT is defined, otherwise all hooks expand to nothing.
+
+
+#ifdef INSTRUMENT
+
+#include <string>
+#include "puzgen.h"
+
+
+/// Time span which is added to trace when it ends.
+class InstrSpan
+{
+    private:
+        const char *name;
+        long long start;
+
+    public:
+        InstrSpan(const char *name);
+        ~InstrSpan();
+};
+
+
+/// Apply rule counting application and its time by rule kind.
+bool instrApplyRule(Rule *rule, Possibilities &pos);
+
+/// Count passes of canSolve() loop.
+void instrSolved(int passes, bool solved);
+
+/// Count rounds of checkSingles() triggered by single change.
+void instrCascade(int depth);
+
+/// Forget all counters and trace events.
+void instrReset();
+
+/// Save counters and trace in Chrome trace event JSON format.
+void instrSaveTrace(const std::wstring &fileName);
+
+
+#define INSTR_SPAN(name)            InstrSpan instrSpan(name)
+#define INSTR_APPLY(rule, pos)      instrApplyRule(rule, pos)
+#define INSTR_SOLVED(passes, res)   instrSolved(passes, res)
+#define INSTR_CASCADE(depth)        instrCascade(depth)
+#define INSTR_SAVE(fileName)        instrSaveTrace(fileName)
+
+#else
+
+#define INSTR_SPAN(name)
+#define INSTR_APPLY(rule, pos)      ((rule)->apply(pos))
+#define INSTR_SOLVED(passes, res)   ((void)(passes), (void)(res))
+#define INSTR_CASCADE(depth)
+#define INSTR_SAVE(fileName)
+
+#endif
+
+
+#endif
+
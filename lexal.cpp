@@ -130,11 +130,12 @@ Lexeme Lexal::readNumber(int startLine, int startPos, wchar_t first)
     Lexeme::Type type = Lexeme::Integer;
     
     while (! reader.isEof()) {
+        pos += reader.readWhile(isDigit, number);
+        if (reader.isEof())
+            break;
         wchar_t ch = reader.getNextChar();
         pos++;
-        if (isDigit(ch))
-            number += ch;
-        else if (L'.' == ch) {
+        if (L'.' == ch) {
             if (Lexeme::Integer == type) {
                 type = Lexeme::Float;
                 number += ch;
@@ -160,16 +161,7 @@ Lexeme Lexal::readIdent(int startLine, int startPos, wchar_t first)
 {
     std::wstring ident;
     ident += first;
-    
-    while (! reader.isEof()) {
-        wchar_t ch = reader.getNextChar();
-        if (! isIdentCont(ch)) {
-            reader.ungetChar(ch);
-            break;
-        }
-        ident += ch;
-        pos++;
-    }
+    pos += reader.readWhile(isIdentCont, ident);
 
     return Lexeme(Lexeme::Ident, ident, startLine, startPos);
 }
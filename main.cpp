@@ -9,6 +9,7 @@
 #include "unicode.h"
 #include "messages.h"
 #include "sound.h"
+#include "instrument.h"
 
 
 Screen screen;
@@ -24,7 +25,8 @@ static void initScreen()
     if (TTF_Init())
         throw Exception(L"Error initializing font engine");
     screen.setMode(VideoMode(800, 600, 24, 
-                getStorage()->get(L"fullscreen", 1) != 0));
+                getStorage()->get(L"fullscreen", 1) != 0,
+                getStorage()->get(L"accelerated", 0) != 0));
     screen.initCursors();
     
     SDL_Surface *mouse = loadImage(L"cursor.bmp");
@@ -101,6 +103,7 @@ int main(int argc, char *argv[])
 //        checkBetaExpire();
         menu();
         getStorage()->flush();
+        INSTR_SAVE(L"einstein-trace.json");
     } catch (Exception &e) {
         std::cerr << L"ERROR: " << e.getMessage() << std::endl;
     } catch (...) {
@@ -11,14 +11,14 @@
 
 
 
-class MenuBackground: public Widget
+class MenuBackground: public StaticLayer
 {
-    public:
-        virtual void draw();
+    protected:
+        virtual void render();
 };
 
 
-void MenuBackground::draw()
+void MenuBackground::render()
 {
     SDL_Surface *title = loadImage(L"nova.bmp");
     screen.draw(0, 0, title);
@@ -31,7 +31,6 @@ void MenuBackground::draw()
     s = L"http://games.flowix.com";
     width = urlFont.getWidth(s);
     urlFont.draw((screen.getWidth() - width) / 2, 60, 255,255,0, true, s);
-    screen.addRegionToUpdate(0, 0, screen.getWidth(), screen.getHeight());
 }
 
 
@@ -83,10 +82,11 @@ class TopScoresCommand: public Command
         TopScoresCommand(Area *a) { area = a; };
 
         virtual void doAction() {
+            ScreenSnapshot snapshot;
             TopScores scores;
             showScoresWindow(area, &scores);
+            snapshot.restore();
             area->updateMouse();
-            area->draw();
         };
 };
 
@@ -100,9 +100,10 @@ class RulesCommand: public Command
         RulesCommand(Area *a) { area = a; };
 
         virtual void doAction() {
+            ScreenSnapshot snapshot;
             showDescription(area);
+            snapshot.restore();
             area->updateMouse();
-            area->draw();
         };
 };
 
@@ -116,9 +117,10 @@ class OptionsCommand: public Command
         OptionsCommand(Area *a) { area = a; };
 
         virtual void doAction() {
+            ScreenSnapshot snapshot;
             showOptionsWindow(area);
+            snapshot.restore();
             area->updateMouse();
-            area->draw();
         };
 };
 
@@ -153,10 +155,11 @@ class AboutCommand: public Command
                         msg(L"ok"), &exitCmd));
             area.add(new KeyAccel(SDLK_ESCAPE, &exitCmd));
             area.add(new KeyAccel(SDLK_RETURN, &exitCmd));
+            ScreenSnapshot snapshot;
             area.run();
 
+            snapshot.restore();
             parentArea->updateMouse();
-            parentArea->draw();
         };
 };
 
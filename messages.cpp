@@ -1,4 +1,5 @@
 #include <stdarg.h>
+#include <wchar.h>
 
 #include "messages.h"
 #include "formatter.h"
@@ -18,6 +19,44 @@ Messages::Messages()
 
 Messages::~Messages()
 {
+    for (Entries::iterator i = messages.begin(); i != messages.end(); i++)
+        delete (*i).message;
+}
+
+
+static unsigned int hashKey(const wchar_t *key)
+{
+    unsigned int h = 2166136261U;
+    for (; *key; key++)
+        h = (h ^ (unsigned int)*key) * 16777619U;
+    return h;
+}
+
+int Messages::findSlot(const wchar_t *key) const
+{
+    int mask = index.size() - 1;
+    int slot = hashKey(key) & mask;
+    while (-1 != index[slot]) {
+        if (! wcscmp(messages[index[slot]].key.c_str(), key))
+            return slot;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void Messages::rehash(int size)
+{
+    index.assign(size, -1);
+    for (int i = 0; i < (int)messages.size(); i++)
+        index[findSlot(messages[i].key.c_str())] = i;
+}
+
+const Formatter* Messages::find(const wchar_t *key) const
+{
+    if (index.empty())
+        return NULL;
+    int no = index[findSlot(key)];
+    return (-1 != no) ? messages[no].message : NULL;
 }
 
 class ResVisitor: public Visitor<Resource*>
@@ -62,11 +101,11 @@ void Messages::loadFromResource(Resource *res, Buffer *buffer)
     }
 }
 
-std::wstring Messages::getMessage(const std::wstring &key) const
+std::wstring Messages::getMessage(const wchar_t *key) const
 {
-    StrMap::const_iterator i = messages.find(key);
-    if (i != messages.end())
-        return (*i).second.message->getMessage();
+    const Formatter *f = find(key);
+    if (f)
+        return f->getMessage();
     else
         return key;
 }
@@ -74,9 +113,9 @@ std::wstring Messages::getMessage(const std::wstring &key) const
 std::wstring Messages::format(const wchar_t *key, va_list ap) const
 {
     std::wstring s;
-    StrMap::const_iterator i = messages.find(key);
-    if (i != messages.end())
-        s = (*i).second.message->format(ap);
+    const Formatter *f = find(key);
+    if (f)
+        f->format(s, ap);
     else
         s = key;
     return s;
@@ -111,21 +150,37 @@ void Messages::loadBundle(int score, unsigned char *data, size_t size)
     int cnt = readInt(data + offset);
     offset += 4;
 
+    // keep index at most half full
+    int indexSize = index.size() ? index.size() : 16;
+    while (indexSize < ((int)messages.size() + cnt) * 2)
+        indexSize *= 2;
+    if (indexSize != (int)index.size())
+        rehash(indexSize);
+
     for (int i = 0; i < cnt; i++) {
         int sz = readInt(data + offset);
         offset += 4;
         if (sz > 0) {
             std::wstring name(fromUtf8((char*)data + offset, sz));
             int msgOffset = readInt(data + offset + sz);
-            StrMap::iterator i = messages.find(name);
-            if (i == messages.end()) {
-                ScoredStr ss = { score, new Formatter(data, msgOffset) };
-                messages[name] = ss;
+            int slot = findSlot(name.c_str());
+            if (-1 == index[slot]) {
+                Entry e = { name, score, new Formatter(data, msgOffset) };
+                index[slot] = messages.size();
+                messages.push_back(e);
             } else {
-                ScoredStr &ss = (*i).second;
-                if (ss.score <= score) {
-                    ss.score = score;
-                    ss.message = new Formatter(data, msgOffset);
+                Entry &e = messages[index[slot]];
+                if (e.score <= score) {
+                    Formatter *f = new Formatter(data, msgOffset);
+                    if (! f->hasSameArgs(*e.message)) {
+                        std::cerr << L"Warning: arguments of message '" << 
+                            name << L"' differ between locales" << std::endl;
+                        delete f;
+                    } else {
+                        delete e.message;
+                        e.score = score;
+                        e.message = f;
+                    }
                 }
             }
         }
@@ -2,8 +2,8 @@
 #define __MESSAGES_H__
 
 
-#include <map>
 #include <string>
+#include <vector>
 #include <stdarg.h>
 
 
@@ -17,11 +17,16 @@ class Messages
 {
     private:
         typedef struct {
+            std::wstring key;
             int score;
             Formatter *message;
-        } ScoredStr;
-        typedef std::map<std::wstring, ScoredStr> StrMap;
-        StrMap messages;
+        } Entry;
+        typedef std::vector<Entry> Entries;
+        Entries messages;
+        
+        /// Open addressing hash table of messages indexes.
+        /// Empty slots contain -1.
+        std::vector<int> index;
     
     public:
         /// Create empty messages table.
@@ -34,12 +39,18 @@ class Messages
 
         /// Get simple text string
         /// \param key message key
-        std::wstring getMessage(const std::wstring &key) const;
+        std::wstring getMessage(const wchar_t *key) const;
+
+        /// Get simple text string
+        /// \param key message key
+        std::wstring getMessage(const std::wstring &key) const {
+            return getMessage(key.c_str());
+        };
 
         /// Shorter alias for getMessage
         /// \param key message key
         std::wstring operator [](const std::wstring &key) const {
-            return getMessage(key);
+            return getMessage(key.c_str());
         };
         
         /// Format message
@@ -57,6 +68,16 @@ class Messages
     private:
         void loadBundle(int score, unsigned char *data, size_t size);
         std::wstring format(const wchar_t *key, va_list ap) const;
+        
+        /// Find message by key.  Returns NULL if message doesn't exists.
+        const Formatter* find(const wchar_t *key) const;
+
+        /// Find slot of key in index.  Returns empty slot if
+        /// message doesn't exists.
+        int findSlot(const wchar_t *key) const;
+
+        /// Rebuild index with enough space for all messages.
+        void rehash(int size);
 };
 
 
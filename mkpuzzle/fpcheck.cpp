@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include "puzgen.h"
+#include "fingerprint.h"
+#include "exceptions.h"
+#include "unicode.h"
+#include "utils.h"
+#include "main.h"
+
+
+/// \file fpcheck.cpp
+/// Invariance check of puzzle fingerprints.  Every puzzle is relabeled
+/// inside rows, maybe mirrored and gets its rules shuffled, fingerprint
+/// must stay the same and filter must take copy for seen puzzle.
+
+
+/// Relabeling of things inside rows and mirroring of columns.
+typedef struct {
+    int labels[PUZZLE_SIZE][PUZZLE_SIZE + 1];
+    bool mirror;
+} Transform;
+
+
+static void genTransform(Transform &transform)
+{
+    for (int row = 0; row < PUZZLE_SIZE; row++) {
+        int *labels = transform.labels[row];
+        for (int i = 0; i <= PUZZLE_SIZE; i++)
+            labels[i] = i;
+        for (int i = PUZZLE_SIZE; i > 1; i--) {
+            int j = rndGen.genInt(i) + 1;
+            int c = labels[i];
+            labels[i] = labels[j];
+            labels[j] = c;
+        }
+    }
+    transform.mirror = rndGen.genInt(2) != 0;
+}
+
+
+static void transformPuzzle(SolvedPuzzle &puzzle, SolvedPuzzle &result,
+        const Transform &transform)
+{
+    for (int row = 0; row < PUZZLE_SIZE; row++)
+        for (int col = 0; col < PUZZLE_SIZE; col++) {
+            int c = transform.mirror ? PUZZLE_SIZE - 1 - col : col;
+            result[row][c] = transform.labels[row][puzzle[row][col]];
+        }
+}
+
+
+/// Write relabeled thing as row and element, the way rules save them.
+static void writeThing(std::ostream &stream, int thing,
+        const Transform &transform)
+{
+    int row = thing / PUZZLE_SIZE;
+    writeInt(stream, row);
+    writeInt(stream, transform.labels[row][thing % PUZZLE_SIZE + 1]);
+}
+
+
+static void writeRule(std::ostream &stream, Rule::Info info,
+        const Transform &transform)
+{
+    switch (info.kind) {
+        case Rule::NEAR_RULE:
+            writeString(stream, L"near");
+            break;
+        case Rule::DIRECTION_RULE:
+            writeString(stream, L"direction");
+            if (transform.mirror)
+                std::swap(info.thing1, info.thing2);
+            break;
+        case Rule::OPEN_RULE:
+            writeString(stream, L"open");
+            writeInt(stream, transform.mirror ? PUZZLE_SIZE - 1 - info.col :
+                    info.col);
+            writeThing(stream, info.thing1, transform);
+            return;
+        case Rule::UNDER_RULE:
+            writeString(stream, L"under");
+            break;
+        case Rule::BETWEEN_RULE:
+            writeString(stream, L"between");
+            break;
+    }
+    writeThing(stream, info.thing1, transform);
+    writeThing(stream, info.thing2, transform);
+    if (info.kind == Rule::BETWEEN_RULE)
+        writeThing(stream, info.center, transform);
+}
+
+
+static void transformRules(Rules &rules, Rules &result,
+        const Transform &transform)
+{
+    std::vector<Rule*> shuffled(rules.begin(), rules.end());
+    for (int i = shuffled.size() - 1; i > 0; i--) {
+        int j = rndGen.genInt(i + 1);
+        Rule *r = shuffled[i];
+        shuffled[i] = shuffled[j];
+        shuffled[j] = r;
+    }
+
+    std::stringstream stream;
+    writeInt(stream, shuffled.size());
+    for (std::vector<Rule*>::iterator i = shuffled.begin();
+            i != shuffled.end(); i++)
+        writeRule(stream, (*i)->getInfo(), transform);
+    loadRules(result, stream);
+}
+
+
+static void deleteRules(Rules &rules)
+{
+    for (Rules::iterator i = rules.begin(); i != rules.end(); i++)
+        delete *i;
+    rules.clear();
+}
+
+
+#define COPIES_CNT  5
+
+
+int main(int argc, char *argv[])
+{
+    int puzzles = (argc > 1) ? atoi(argv[1]) : 2000;
+    long long failed = 0;
+    int mirrored = 0;
+
+    rndGen = Random(12345UL);
+    try {
+        PuzzleFilter filter(puzzles, 0.0001);
+        for (int i = 0; i < puzzles; i++) {
+            SolvedPuzzle puzzle;
+            Rules rules;
+            genPuzzle(puzzle, rules);
+            Fingerprint fingerprint;
+            getFingerprint(puzzle, rules, fingerprint);
+            filter.add(fingerprint);
+
+            for (int j = 0; j < COPIES_CNT; j++) {
+                Transform transform;
+                genTransform(transform);
+                if (transform.mirror)
+                    mirrored++;
+                SolvedPuzzle copy;
+                transformPuzzle(puzzle, copy, transform);
+                Rules copyRules;
+                transformRules(rules, copyRules, transform);
+                Fingerprint copyFingerprint;
+                getFingerprint(copy, copyRules, copyFingerprint);
+                if ((copyFingerprint.high != fingerprint.high) ||
+                        (copyFingerprint.low != fingerprint.low) ||
+                        filter.add(copyFingerprint))
+                {
+                    if (! failed)
+                        std::cerr << "Fingerprint changed for copy of puzzle "
+                            << i << std::endl;
+                    failed++;
+                }
+                deleteRules(copyRules);
+            }
+
+            deleteRules(rules);
+        }
+    } catch (Exception &e) {
+        std::cerr << toMbcs(e.getMessage()) << std::endl;
+        return 1;
+    }
+
+    std::cout << puzzles * COPIES_CNT << " copies, " << mirrored <<
+        " mirrored" << std::endl;
+    std::cout << failed << " mismatches" << std::endl;
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,247 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <iostream>
+#include <fstream>
+#include "puzgen.h"
+#include "grader.h"
+#include "fingerprint.h"
+#include "instrument.h"
+#include "exceptions.h"
+#include "unicode.h"
+#include "main.h"
+
+
+/// \file main.cpp
+/// Puzzle generator tool.  Prints puzzles with their difficulty,
+/// so generator can be tuned without the game.
+
+
+static int count = 1;
+static bool hasId = false;
+static PuzzleId id = 0;
+static bool subsets = false;
+static bool hasTarget = false;
+static DifficultyTarget target = { 0, 0, { 4, 4, 1, 2, 3 } };
+static bool quiet = false;
+static std::string filterFile;
+#ifdef INSTRUMENT
+static std::string traceFile;
+#endif
+
+
+static void printHelp(int terminate)
+{
+    std::cerr << "USAGE:" << std::endl;
+    std::cerr << "  mkpuzzle [options]" << std::endl;
+    std::cerr << "OPTIONS:" << std::endl;
+    std::cerr << "  --count <n>            generate n puzzles" << std::endl;
+    std::cerr << "  --id <id>              generate puzzle with given ID or "
+        "seed" << std::endl;
+    std::cerr << "  --subsets              use pairs and triples in new IDs" <<
+        std::endl;
+    std::cerr << "  --chain <min>-<max>    generate puzzles with chain "
+        "length in band" << std::endl;
+    std::cerr << "  --weights <n,d,o,u,b>  frequency of near, direction, "
+        "open," << std::endl;
+    std::cerr << "                         under and between rules for "
+        "--chain" << std::endl;
+    std::cerr << "  --quiet                print difficulty only" << std::endl;
+    std::cerr << "  --filter <file>        skip puzzles seen before, "
+        "keep them in file" << std::endl;
+#ifdef INSTRUMENT
+    std::cerr << "  --trace <file>         save generator trace" << std::endl;
+#endif
+    std::cerr << "  --help                 this help screen" << std::endl;
+    if (terminate >= 0)
+        exit(terminate);
+}
+
+
+static void parseArgs(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if ((! strcmp(argv[i], "--count")) && (i < argc - 1)) {
+            count = atoi(argv[++i]);
+            if (count <= 0) {
+                std::cerr << "Invalid count" << std::endl;
+                exit(1);
+            }
+        } else if ((! strcmp(argv[i], "--id")) && (i < argc - 1)) {
+            id = puzzleIdFromString(fromMbcs(argv[++i]));
+            hasId = true;
+        } else if (! strcmp(argv[i], "--subsets"))
+            subsets = true;
+        else if ((! strcmp(argv[i], "--chain")) && (i < argc - 1)) {
+            if (2 != sscanf(argv[++i], "%d-%d", &target.minChain,
+                        &target.maxChain))
+            {
+                std::cerr << "Invalid chain band" << std::endl;
+                exit(1);
+            }
+            hasTarget = true;
+        } else if ((! strcmp(argv[i], "--weights")) && (i < argc - 1)) {
+            int *w = target.kindWeights;
+            if (5 != sscanf(argv[++i], "%d,%d,%d,%d,%d", &w[0], &w[1], &w[2],
+                        &w[3], &w[4]))
+            {
+                std::cerr << "Invalid weights" << std::endl;
+                exit(1);
+            }
+        } else if (! strcmp(argv[i], "--quiet"))
+            quiet = true;
+        else if ((! strcmp(argv[i], "--filter")) && (i < argc - 1))
+            filterFile = argv[++i];
+#ifdef INSTRUMENT
+        else if ((! strcmp(argv[i], "--trace")) && (i < argc - 1))
+            traceFile = argv[++i];
+#endif
+        else if (! strcmp(argv[i], "--help"))
+            printHelp(0);
+        else {
+            std::cerr << "Invalid option '" << argv[i] << "'" << std::endl;
+            printHelp(1);
+        }
+    }
+}
+
+
+static void printPuzzle(SolvedPuzzle &puzzle)
+{
+    for (int i = 0; i < PUZZLE_SIZE; i++) {
+        char prefix = 'A' + i;
+        for (int j = 0; j < PUZZLE_SIZE; j++) {
+            if (j)
+                std::cout << "  ";
+            std::cout << prefix << puzzle[i][j];
+        }
+        std::cout << std::endl;
+    }
+}
+
+
+static void printRules(Rules &rules)
+{
+    for (Rules::iterator i = rules.begin(); i != rules.end(); i++)
+        std::cout << toMbcs((*i)->getAsText()) << std::endl;
+}
+
+
+static void printDifficulty(Rules &rules, bool subsets)
+{
+    Difficulty d;
+    gradePuzzle(rules, d, subsets);
+    std::cout << "rules " << d.rulesCnt << " rounds " << d.rounds <<
+        " near " << d.deductions[Rule::NEAR_RULE] <<
+        " direction " << d.deductions[Rule::DIRECTION_RULE] <<
+        " open " << d.deductions[Rule::OPEN_RULE] <<
+        " under " << d.deductions[Rule::UNDER_RULE] <<
+        " between " << d.deductions[Rule::BETWEEN_RULE] <<
+        " cascade " << d.cascadeDepth << " chain " << d.chainLength <<
+        std::endl;
+}
+
+
+static void deleteRules(Rules &rules)
+{
+    for (Rules::iterator i = rules.begin(); i != rules.end(); i++)
+        delete *i;
+    rules.clear();
+}
+
+
+/// Probability to take new puzzle for seen one.
+#define FILTER_ERROR_RATE   0.0001
+
+/// Load filter of seen puzzles or create empty one for count puzzles.
+static PuzzleFilter* openFilter()
+{
+    std::ifstream stream(filterFile.c_str());
+    if (stream.fail())
+        return new PuzzleFilter(count, FILTER_ERROR_RATE);
+    stream.close();
+    return new PuzzleFilter(fromMbcs(filterFile));
+}
+
+
+static long long getTime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+
+int main(int argc, char *argv[])
+{
+    int res = 0;
+
+    try {
+        parseArgs(argc, argv);
+        PuzzleFilter *filter = filterFile.length() ? openFilter() : NULL;
+        int missed = 0;
+        int duplicates = 0;
+        long long usecs = 0;
+        for (int i = 0; i < count; i++) {
+            SolvedPuzzle puzzle;
+            Rules rules;
+            PuzzleId puzzleId = hasId ? id : genPuzzleId(subsets && 
+                    ! hasTarget);
+            long long start = getTime();
+            if (hasTarget) {
+                bool reached = genPuzzle(puzzle, rules, target, puzzleId);
+                usecs += getTime() - start;
+                if (! reached) {
+                    missed++;
+                    deleteRules(rules);
+                    continue;
+                }
+            } else {
+                genPuzzle(puzzle, rules, puzzleId);
+                usecs += getTime() - start;
+            }
+            if (filter) {
+                Fingerprint fingerprint;
+                getFingerprint(puzzle, rules, fingerprint);
+                if (! filter->add(fingerprint)) {
+                    duplicates++;
+                    deleteRules(rules);
+                    continue;
+                }
+            }
+            if (! quiet) {
+                std::cout << (hasTarget ? "seed " : "id ") <<
+                    toMbcs(puzzleIdToString(puzzleId)) << std::endl;
+                printPuzzle(puzzle);
+                printRules(rules);
+            }
+            printDifficulty(rules, (! hasTarget) && 
+                    (puzzleId & PUZZLE_ID_SUBSETS));
+            if (! quiet)
+                std::cout << std::endl;
+            deleteRules(rules);
+        }
+
+        std::cerr << count << " puzzles in " << usecs / 1000 << " ms";
+        if (missed)
+            std::cerr << ", " << missed << " out of chain band";
+        if (duplicates)
+            std::cerr << ", " << duplicates << " duplicates";
+        std::cerr << std::endl;
+        if (filter) {
+            filter->save(fromMbcs(filterFile));
+            delete filter;
+        }
+#ifdef INSTRUMENT
+        if (traceFile.length())
+            INSTR_SAVE(fromMbcs(traceFile));
+#endif
+    } catch (Exception &e) {
+        std::cerr << toMbcs(e.getMessage()) << std::endl;
+        res = 1;
+    }
+
+    return res;
+}
+
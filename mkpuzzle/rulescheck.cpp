@@ -0,0 +1,322 @@
+#include <stdlib.h>
+#include <iostream>
+#include "puzgen.h"
+#include "exceptions.h"
+#include "unicode.h"
+#include "main.h"
+
+
+/// \file rulescheck.cpp
+/// Differential check of rules propagation.  Rules work on columns
+/// masks of possibilities, here every application is compared with
+/// plain scan over possibilities which rules used before.
+
+
+// Reference propagation.  Things are given as row and element.
+
+static bool nearToCol(Possibilities &pos, int col, int nearRow, int nearNum,
+        int thisRow, int thisNum)
+{
+    bool hasLeft, hasRight;
+
+    if (col == 0)
+        hasLeft = false;
+    else
+        hasLeft = pos.isPossible(col - 1, nearRow, nearNum);
+    if (col == PUZZLE_SIZE-1)
+        hasRight = false;
+    else
+        hasRight = pos.isPossible(col + 1, nearRow, nearNum);
+
+    if ((! hasRight) && (! hasLeft) && pos.isPossible(col, thisRow, thisNum)) {
+        pos.exclude(col, thisRow, thisNum);
+        return true;
+    } else
+        return false;
+}
+
+static bool applyNear(Possibilities &pos, int row1, int thing1, int row2,
+        int thing2)
+{
+    bool changed = false;
+
+    for (int i = 0; i < PUZZLE_SIZE; i++) {
+        if (nearToCol(pos, i, row1, thing1, row2, thing2))
+            changed = true;
+        if (nearToCol(pos, i, row2, thing2, row1, thing1))
+            changed = true;
+    }
+
+    if (changed)
+        applyNear(pos, row1, thing1, row2, thing2);
+
+    return changed;
+}
+
+static bool applyDirection(Possibilities &pos, int row1, int thing1,
+        int row2, int thing2)
+{
+    bool changed = false;
+
+    for (int i = 0; i < PUZZLE_SIZE; i++) {
+        if (pos.isPossible(i, row2, thing2)) {
+            pos.exclude(i, row2, thing2);
+            changed = true;
+        }
+        if (pos.isPossible(i, row1, thing1))
+            break;
+    }
+
+    for (int i = PUZZLE_SIZE-1; i >= 0; i--) {
+        if (pos.isPossible(i, row1, thing1)) {
+            pos.exclude(i, row1, thing1);
+            changed = true;
+        }
+        if (pos.isPossible(i, row2, thing2))
+            break;
+    }
+
+    return changed;
+}
+
+static bool applyOpen(Possibilities &pos, int col, int row, int thing)
+{
+    if (! pos.isDefined(col, row)) {
+        pos.set(col, row, thing);
+        return true;
+    } else
+        return false;
+}
+
+static bool applyUnder(Possibilities &pos, int row1, int thing1, int row2,
+        int thing2)
+{
+    bool changed = false;
+
+    for (int i = 0; i < PUZZLE_SIZE; i++) {
+        if ((! pos.isPossible(i, row1, thing1)) &&
+                pos.isPossible(i, row2, thing2))
+        {
+            pos.exclude(i, row2, thing2);
+            changed = true;
+        }
+        if ((! pos.isPossible(i, row2, thing2)) &&
+                pos.isPossible(i, row1, thing1))
+        {
+            pos.exclude(i, row1, thing1);
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+static bool betweenSide(Possibilities &pos, int i, int row, int thing,
+        int otherRow, int otherThing, int centerRow, int centerThing)
+{
+    bool leftPossible, rightPossible;
+
+    if (! pos.isPossible(i, row, thing))
+        return false;
+    if (i < 2)
+        leftPossible = false;
+    else
+        leftPossible = (pos.isPossible(i-1, centerRow, centerThing)
+                && pos.isPossible(i-2, otherRow, otherThing));
+    if (i >= PUZZLE_SIZE - 2)
+        rightPossible = false;
+    else
+        rightPossible = (pos.isPossible(i+1, centerRow, centerThing)
+                && pos.isPossible(i+2, otherRow, otherThing));
+    if ((! leftPossible) && (! rightPossible)) {
+        pos.exclude(i, row, thing);
+        return true;
+    }
+    return false;
+}
+
+static bool applyBetween(Possibilities &pos, int row1, int thing1,
+        int row2, int thing2, int centerRow, int centerThing)
+{
+    bool changed = false;
+
+    if (pos.isPossible(0, centerRow, centerThing)) {
+        changed = true;
+        pos.exclude(0, centerRow, centerThing);
+    }
+
+    if (pos.isPossible(PUZZLE_SIZE-1, centerRow, centerThing)) {
+        changed = true;
+        pos.exclude(PUZZLE_SIZE-1, centerRow, centerThing);
+    }
+
+    bool goodLoop;
+    do {
+        goodLoop = false;
+
+        for (int i = 1; i < PUZZLE_SIZE-1; i++) {
+            if (pos.isPossible(i, centerRow, centerThing)) {
+                if (! ((pos.isPossible(i-1, row1, thing1) &&
+                            pos.isPossible(i+1, row2, thing2)) ||
+                        (pos.isPossible(i-1, row2, thing2) &&
+                            pos.isPossible(i+1, row1, thing1))))
+                {
+                    pos.exclude(i, centerRow, centerThing);
+                    goodLoop = true;
+                }
+            }
+        }
+
+        for (int i = 0; i < PUZZLE_SIZE; i++) {
+            if (betweenSide(pos, i, row2, thing2, row1, thing1, centerRow,
+                        centerThing))
+                goodLoop = true;
+            if (betweenSide(pos, i, row1, thing1, row2, thing2, centerRow,
+                        centerThing))
+                goodLoop = true;
+        }
+
+        if (goodLoop)
+            changed = true;
+    } while (goodLoop);
+
+    return changed;
+}
+
+
+static bool applyReference(Rule *rule, Possibilities &pos)
+{
+    Rule::Info info = rule->getInfo();
+    int row1 = info.thing1 / PUZZLE_SIZE;
+    int thing1 = info.thing1 % PUZZLE_SIZE + 1;
+    int row2 = info.thing2 / PUZZLE_SIZE;
+    int thing2 = info.thing2 % PUZZLE_SIZE + 1;
+
+    switch (info.kind) {
+        case Rule::NEAR_RULE:
+            return applyNear(pos, row1, thing1, row2, thing2);
+        case Rule::DIRECTION_RULE:
+            return applyDirection(pos, row1, thing1, row2, thing2);
+        case Rule::OPEN_RULE:
+            return applyOpen(pos, info.col, row1, thing1);
+        case Rule::UNDER_RULE:
+            return applyUnder(pos, row1, thing1, row2, thing2);
+        case Rule::BETWEEN_RULE:
+            return applyBetween(pos, row1, thing1, row2, thing2,
+                    info.center / PUZZLE_SIZE, info.center % PUZZLE_SIZE + 1);
+    }
+    return false;
+}
+
+
+/// Check that possibilities are equal and columns masks follow them.
+static bool isSame(Possibilities &pos, Possibilities &reference)
+{
+    for (int row = 0; row < PUZZLE_SIZE; row++)
+        for (int element = 1; element <= PUZZLE_SIZE; element++) {
+            int mask = 0;
+            for (int col = 0; col < PUZZLE_SIZE; col++) {
+                bool possible = pos.isPossible(col, row, element);
+                if (possible != reference.isPossible(col, row, element))
+                    return false;
+                if (possible)
+                    mask |= 1 << col;
+            }
+            if (mask != pos.getColumns(row, element))
+                return false;
+        }
+    return true;
+}
+
+
+static void genSolvedPuzzle(SolvedPuzzle &puzzle)
+{
+    for (int row = 0; row < PUZZLE_SIZE; row++) {
+        for (int col = 0; col < PUZZLE_SIZE; col++)
+            puzzle[row][col] = col + 1;
+        for (int col = PUZZLE_SIZE - 1; col > 0; col--) {
+            int j = rndGen.genInt(col + 1);
+            short c = puzzle[row][col];
+            puzzle[row][col] = puzzle[row][j];
+            puzzle[row][j] = c;
+        }
+    }
+}
+
+
+/// Random state of possibilities.  Valid state keeps solution possible,
+/// other may contradict rules.
+static void genState(Possibilities &pos, SolvedPuzzle &puzzle, bool valid)
+{
+    int excluded = rndGen.genInt(120);
+    for (int i = 0; i < excluded; i++) {
+        int col = rndGen.genInt(PUZZLE_SIZE);
+        int row = rndGen.genInt(PUZZLE_SIZE);
+        int element = rndGen.genInt(PUZZLE_SIZE) + 1;
+        if ((! valid) || (puzzle[row][col] != element))
+            pos.exclude(col, row, element);
+    }
+}
+
+
+#define RULES_CNT   30
+#define STATES_CNT  20
+
+
+int main(int argc, char *argv[])
+{
+    int puzzles = (argc > 1) ? atoi(argv[1]) : 3000;
+    long long applied[RULE_KINDS_CNT] = { 0 };
+    long long changed[RULE_KINDS_CNT] = { 0 };
+    long long failed = 0;
+
+    rndGen = Random(12345UL);
+    try {
+        for (int i = 0; i < puzzles; i++) {
+            SolvedPuzzle puzzle;
+            genSolvedPuzzle(puzzle);
+            Rules rules;
+            for (int j = 0; j < RULES_CNT; j++)
+                rules.push_back(genRule(puzzle));
+
+            for (int state = 0; state < STATES_CNT; state++) {
+                Possibilities base;
+                genState(base, puzzle, state < STATES_CNT / 2);
+                for (Rules::iterator j = rules.begin(); j != rules.end();
+                        j++)
+                {
+                    Rule *rule = *j;
+                    Possibilities pos(base), reference(base);
+                    bool res = rule->apply(pos);
+                    bool refRes = applyReference(rule, reference);
+                    int kind = rule->getInfo().kind;
+                    applied[kind]++;
+                    if (res)
+                        changed[kind]++;
+                    if ((res != refRes) || ! isSame(pos, reference)) {
+                        if (! failed)
+                            std::cerr << "Mismatch after rule " <<
+                                toMbcs(rule->getAsText()) << std::endl;
+                        failed++;
+                    }
+                }
+            }
+
+            for (Rules::iterator j = rules.begin(); j != rules.end(); j++)
+                delete *j;
+        }
+    } catch (Exception &e) {
+        std::cerr << toMbcs(e.getMessage()) << std::endl;
+        return 1;
+    }
+
+    static const char *names[RULE_KINDS_CNT] = { "near", "direction",
+        "open", "under", "between" };
+    for (int i = 0; i < RULE_KINDS_CNT; i++)
+        std::cout << names[i] << ": " << applied[i] << " applied, " <<
+            changed[i] << " changed" << std::endl;
+    std::cout << failed << " mismatches" << std::endl;
+
+    return failed ? 1 : 0;
+}
+
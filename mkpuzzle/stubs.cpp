@@ -0,0 +1,99 @@
+#include <sys/time.h>
+#include "main.h"
+#include "utils.h"
+#include "iconset.h"
+#include "unicode.h"
+
+
+/// \file stubs.cpp
+/// Game objects which puzzle code refers to.  Tools never draw
+/// rules, so these do nothing.
+
+
+Random rndGen;
+Screen screen;
+
+
+Screen::Screen()
+{
+}
+
+Screen::~Screen()
+{
+}
+
+void Screen::draw(int x, int y, SDL_Surface *tile)
+{
+}
+
+
+void IconSet::draw(int x, int y, const SDL_Rect &icon)
+{
+}
+
+const SDL_Rect& IconSet::getLargeIcon(int row, int num, bool highlighted)
+{
+    return emptyFieldIcon;
+}
+
+
+int gettimeofday(struct timeval* tp)
+{
+    return gettimeofday(tp, NULL);
+}
+
+
+// Streams helpers are taken from utils.cpp, which needs the whole game.
+
+int readInt(std::istream &stream)
+{
+    if (stream.fail())
+        throw Exception(L"Error reading string");
+    unsigned char buf[4];
+    stream.read((char*)buf, 4);
+    if (stream.fail())
+        throw Exception(L"Error reading string");
+    return buf[0] + buf[1] * 256 + buf[2] * 256 * 256 + 
+        buf[3] * 256 * 256 * 256;
+}
+
+std::wstring readString(std::istream &stream)
+{
+    std::string str;
+    char c;
+
+    if (stream.fail())
+        throw Exception(L"Error reading string");
+    
+    c = stream.get();
+    while (c && (! stream.fail())) {
+        str += c;
+        c = stream.get();
+    }
+
+    if (stream.fail())
+        throw Exception(L"Error reading string");
+
+    return fromUtf8(str);
+}
+
+void writeInt(std::ostream &stream, int v)
+{
+    unsigned char b[4];
+    int i, ib;
+
+    for (i = 0; i < 4; i++) {
+        ib = v & 0xFF;
+        v = v >> 8;
+        b[i] = ib;
+    }
+    
+    stream.write((char*)&b, 4);
+}
+
+void writeString(std::ostream &stream, const std::wstring &value)
+{
+    std::string s(toUtf8(value));
+    stream.write(s.c_str(), s.length() + 1);
+}
+
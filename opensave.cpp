@@ -1,5 +1,11 @@
 #include <time.h>
+#include <stdio.h>
+#include <string.h>
 #include <fstream>
+#include <vector>
+#include <algorithm>
+#include <sys/types.h>
+#include <dirent.h>
 #include "exceptions.h"
 #include "utils.h"
 #include "widgets.h"
@@ -8,47 +14,316 @@
 #include "unicode.h"
 #include "convert.h"
 #include "messages.h"
+#include "main.h"
 
 
 
-#define MAX_SLOTS 10
+#define SLOTS_PER_PAGE  10
 
+#define INDEX_MAGIC     0x58444953
+#define INDEX_VERSION   1
 
+
+/// Description of saved game kept in saves index.
 class SavedGame
 {
     private:
-        std::wstring fileName;
+        int slot;
         bool exists;
         std::wstring name;
+        int saveTime;
+        int elapsed;
+        unsigned char thumbnail[PUZZLE_SIZE][PUZZLE_SIZE];
 
     public:
-        SavedGame(const std::wstring &fileName);
-        SavedGame(const SavedGame &s): fileName(s.fileName), name(s.name) {
-            exists = s.exists;
-        };
+        /// Create empty slot.
+        SavedGame(int slot);
+
+        /// Create description of game being saved.
+        /// \param game saved game or NULL if details are unknown.
+        SavedGame(int slot, const std::wstring &name, Game *game);
+
+        /// Read description from saves index.
+        SavedGame(std::istream &stream);
 
     public:
-        const std::wstring& getFileName() { return fileName; };
-        std::wstring getName() { return exists ? name : msg(L"empty"); };
-        bool isExists() { return exists; };
+        int getSlot() const { return slot; };
+        std::wstring getName() const { return exists ? name : msg(L"empty"); };
+        bool isExists() const { return exists; };
+        int getSaveTime() const { return saveTime; };
+        int getElapsed() const { return elapsed; };
+
+        /// Get element shown in cell when game was saved, 0 if undefined.
+        int getThumbnail(int col, int row) const { 
+            return thumbnail[col][row]; 
+        };
+
+        /// Write description to saves index.
+        void save(std::ostream &stream) const;
 };
 
 
-SavedGame::SavedGame(const std::wstring &s): fileName(s)
+SavedGame::SavedGame(int s)
 {
+    slot = s;
     exists = false;
+    saveTime = elapsed = 0;
+    memset(thumbnail, 0, sizeof(thumbnail));
+}
+
+SavedGame::SavedGame(int s, const std::wstring &n, Game *game): name(n)
+{
+    slot = s;
+    exists = true;
+    saveTime = elapsed = 0;
+    memset(thumbnail, 0, sizeof(thumbnail));
+    if (! game)     // save file made before saves index
+        return;
+    
+    saveTime = time(NULL);
+    elapsed = game->getElapsed();
+    Possibilities *pos = game->getPossibilities();
+    for (int i = 0; i < PUZZLE_SIZE; i++)
+        for (int j = 0; j < PUZZLE_SIZE; j++)
+            thumbnail[i][j] = pos->isDefined(i, j) ? pos->getDefined(i, j) : 0;
+}
+
+SavedGame::SavedGame(std::istream &stream)
+{
+    slot = readInt(stream);
+    exists = true;
+    name = readString(stream);
+    saveTime = readInt(stream);
+    elapsed = readInt(stream);
+    stream.read((char*)thumbnail, sizeof(thumbnail));
+    if (stream.fail())
+        throw Exception(L"Error reading saves index");
+}
+
+void SavedGame::save(std::ostream &stream) const
+{
+    writeInt(stream, slot);
+    writeString(stream, name);
+    writeInt(stream, saveTime);
+    writeInt(stream, elapsed);
+    stream.write((const char*)thumbnail, sizeof(thumbnail));
+}
+
+
+class SlotLessThen
+{
+    public:
+        bool operator() (const SavedGame &g1, const SavedGame &g2) const {
+            return g1.getSlot() < g2.getSlot();
+        };
+};
+
+
+/// Index of saved games.  Allows to list saves without opening 
+/// every save file.
+class SavesIndex
+{
+    private:
+        typedef std::vector<SavedGame> Games;
+        std::wstring path;
+        Games games;            /// saved games sorted by slot
+
+    public:
+        /// Load index of saves directory.
+        /// If index is missing it will be rebuilt from save files.
+        SavesIndex(const std::wstring &path);
+
+    public:
+        /// Get number of saved games.
+        int getCount() const { return games.size(); };
+        
+        /// Get saved game description.
+        /// \param no number of saved game in index.
+        const SavedGame& getGame(int no) const { return games[no]; };
+
+        /// Get slot number unused by saved games.
+        int getFreeSlot() const;
+
+        /// Get name of save file.
+        /// \param slot slot number
+        std::wstring getFileName(int slot) const;
+
+        /// Add or replace saved game and write index.
+        /// \param game description of saved game.
+        void update(const SavedGame &game);
+
+    private:
+        std::wstring getIndexFileName() const { return path + L"/index"; };
+        void getSlots(std::vector<int> &slots);
+        bool load();
+        void rebuild();
+        bool write();
+};
+
+
+SavesIndex::SavesIndex(const std::wstring &p): path(p)
+{
+    if (! load()) {
+        rebuild();
+        write();
+    }
+}
+
+/// Get sorted slot numbers of save files in directory.
+void SavesIndex::getSlots(std::vector<int> &slots)
+{
+    DIR *dir = opendir(toMbcs(path).c_str());
+    if (! dir)
+        return;
+    struct dirent *de;
+    while ((de = readdir(dir))) {
+        std::wstring s(fromMbcs(de->d_name));
+        if ((s.length() < 5) || (s.substr(s.length() - 4) != L".sav"))
+            continue;
+        bool isSlot = true;
+        for (unsigned int i = 0; i < s.length() - 4; i++)
+            if ((s[i] < L'0') || (s[i] > L'9'))
+                isSlot = false;
+        if (isSlot)
+            slots.push_back(strToInt(s.substr(0, s.length() - 4)));
+    }
+    closedir(dir);
+    std::sort(slots.begin(), slots.end());
+}
+
+bool SavesIndex::load()
+{
+    std::ifstream stream(toMbcs(getIndexFileName()).c_str(), 
+            std::ifstream::in | std::ifstream::binary);
+    if (stream.fail())
+        return false;
     
     try {
-        std::ifstream stream(toMbcs(fileName).c_str(), std::ifstream::in | 
-                std::ifstream::binary);
-        if (stream.fail())
-            throw Exception(L"Can't open file");
-        name = readString(stream);
-        stream.close();
-        exists = true;
-    } catch (...) { }
+        if ((readInt(stream) != INDEX_MAGIC) || 
+                (readInt(stream) != INDEX_VERSION))
+            return false;
+        int cnt = readInt(stream);
+        for (int i = 0; i < cnt; i++)
+            games.push_back(SavedGame(stream));
+    } catch (...) {
+        games.clear();
+        return false;
+    }
+
+    // index is stale if save files were added or removed behind it
+    std::vector<int> slots;
+    getSlots(slots);
+    bool same = (slots.size() == games.size());
+    for (unsigned int i = 0; same && (i < slots.size()); i++)
+        same = (slots[i] == games[i].getSlot());
+    if (! same)
+        games.clear();
+    return same;
 }
 
+void SavesIndex::rebuild()
+{
+    games.clear();
+    
+    std::vector<int> slots;
+    getSlots(slots);
+    for (std::vector<int>::iterator i = slots.begin(); i != slots.end(); i++)
+        try {
+            std::ifstream stream(toMbcs(getFileName(*i)).c_str(), 
+                    std::ifstream::in | std::ifstream::binary);
+            if (stream.fail())
+                throw Exception(L"Can't open file");
+            SavedGame game(*i, readString(stream), NULL);
+            games.push_back(game);
+        } catch (...) { }
+}
+
+bool SavesIndex::write()
+{
+    std::string name(toMbcs(getIndexFileName()));
+    std::string tmpName(name + ".tmp");
+    std::ofstream stream(tmpName.c_str(), std::ofstream::out | 
+            std::ofstream::binary);
+    if (stream.fail())
+        return false;
+    
+    writeInt(stream, INDEX_MAGIC);
+    writeInt(stream, INDEX_VERSION);
+    writeInt(stream, games.size());
+    for (Games::iterator i = games.begin(); i != games.end(); i++)
+        (*i).save(stream);
+
+    bool ok = stream.good();
+    stream.close();
+    if ((! ok) || (! replaceFile(tmpName, name))) {
+        remove(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
+
+int SavesIndex::getFreeSlot() const
+{
+    int slot = 0;
+    for (Games::const_iterator i = games.begin(); i != games.end(); i++)
+        if ((*i).getSlot() == slot)
+            slot++;
+    return slot;
+}
+
+std::wstring SavesIndex::getFileName(int slot) const
+{
+    return path + L"/" + toString(slot) + L".sav";
+}
+
+void SavesIndex::update(const SavedGame &game)
+{
+    SlotLessThen comparator;
+    Games::iterator i = std::lower_bound(games.begin(), games.end(), game,
+            comparator);
+    if ((i != games.end()) && ((*i).getSlot() == game.getSlot()))
+        *i = game;
+    else
+        games.insert(i, game);
+    
+    // stale index would hide this save, let it be rebuilt next time
+    if (! write()) {
+        remove(toMbcs(getIndexFileName()).c_str());
+        std::cerr << "Error writing saves index" << std::endl;
+    }
+}
+
+
+/// Small map of cells defined in saved game.
+class SaveThumbnail: public Widget
+{
+    private:
+        int left, top;
+        const SavedGame &game;
+
+    public:
+        SaveThumbnail(int x, int y, const SavedGame &g): game(g) {
+            left = x;
+            top = y;
+        };
+
+    public:
+        virtual void draw();
+};
+
+void SaveThumbnail::draw()
+{
+    SDL_Surface *s = screen.getSurface();
+    Uint32 defined = SDL_MapRGB(s->format, 255, 255, 0);
+    Uint32 undefined = SDL_MapRGB(s->format, 0, 0, 128);
+    for (int row = 0; row < PUZZLE_SIZE; row++)
+        for (int col = 0; col < PUZZLE_SIZE; col++) {
+            SDL_Rect rect = { left + col * 4, top + row * 4, 3, 3 };
+            SDL_FillRect(s, &rect, game.getThumbnail(col, row) ? 
+                    defined : undefined);
+        }
+    screen.addRegionToUpdate(left, top, PUZZLE_SIZE * 4, PUZZLE_SIZE * 4);
+}
 
 
 class OkCommand: public Command
@@ -68,10 +343,35 @@ class OkCommand: public Command
 
 
 
+class PageCommand: public Command
+{
+    private:
+        Area &area;
+        int &page;
+        int delta;
+        bool &turned;
+    
+    public:
+        PageCommand(Area &a, int &p, int d, bool &t): area(a), page(p), 
+            turned(t) 
+        { 
+            delta = d; 
+        };
+        
+        virtual void doAction() {
+            page += delta;
+            turned = true;
+            area.finishEventLoop();
+        };
+};
+
+
+
 class SaveCommand: public Command
 {
     private:
-        SavedGame &savedGame;
+        const SavedGame &savedGame;
+        SavesIndex &index;
         Area *parentArea;
         bool *saved;
         Font *font;
@@ -79,8 +379,9 @@ class SaveCommand: public Command
         Game *game;
 
     public:
-        SaveCommand(SavedGame &sg, Font *f, Area *area, bool *s,
-                const std::wstring &dflt, Game *g): savedGame(sg), defaultName(dflt) 
+        SaveCommand(const SavedGame &sg, SavesIndex &idx, Font *f, 
+                Area *area, bool *s, const std::wstring &dflt, Game *g): 
+            savedGame(sg), index(idx), defaultName(dflt) 
         {
             parentArea = area;
             saved = s;
@@ -114,7 +415,8 @@ class SaveCommand: public Command
             if (*saved) {
                 *saved = false;
                 try {
-                    std::ofstream stream(toMbcs(savedGame.getFileName()).
+                    int slot = savedGame.getSlot();
+                    std::ofstream stream(toMbcs(index.getFileName(slot)).
                         c_str(), std::ofstream::out | std::ofstream::binary);
                     if (stream.fail())
                         throw Exception(L"Error creating save file");
@@ -123,6 +425,7 @@ class SaveCommand: public Command
                     if (stream.fail())
                         throw Exception(L"Error saving game");
                     stream.close();
+                    index.update(SavedGame(slot, name, game));
                     *saved = true;
                 } catch (...) { 
                     showMessageWindow(&area, L"redpattern.bmp", 300, 80, font,
@@ -155,10 +458,14 @@ static std::wstring getSavesPath()
 
 
 typedef std::list<SavedGame> SavesList;
+typedef std::vector<Command*> Commands;
 
 
-static void showListWindow(SavesList &list, Command **commands,
-        const std::wstring &title, Area &area, Font *font)
+/// Show page of saves list.
+/// Returns true if other page was selected.
+static bool showListWindow(SavesList &list, Commands &commands,
+        const std::wstring &title, Area &area, Font *font, 
+        int &page, int pagesCnt)
 {
     Font titleFont(L"nova.ttf", 26);
 
@@ -170,42 +477,77 @@ static void showListWindow(SavesList &list, Command **commands,
                 msg(L"close"), &exitCmd));
     area.add(new KeyAccel(SDLK_ESCAPE, &exitCmd)); 
 
+    bool turned = false;
+    PageCommand prevCmd(area, page, -1, turned);
+    PageCommand nextCmd(area, page, 1, turned);
+    if (page > 0) {
+        area.add(new Button(260, 470, 40, 25, font, 255,255,0, L"blue.bmp", 
+                    L"<", &prevCmd));
+        area.add(new KeyAccel(SDLK_PAGEUP, &prevCmd)); 
+    }
+    if (page < pagesCnt - 1) {
+        area.add(new Button(500, 470, 40, 25, font, 255,255,0, L"blue.bmp", 
+                    L">", &nextCmd));
+        area.add(new KeyAccel(SDLK_PAGEDOWN, &nextCmd)); 
+    }
+
     int pos = 150;
     int no = 0;
     for (SavesList::iterator i = list.begin(); i != list.end(); i++) {
         SavedGame &game = *i;
-        area.add(new Button(260, pos, 280, 25, font, 255,255,255, L"blue.bmp", 
+        area.add(new Button(260, pos, 250, 25, font, 255,255,255, L"blue.bmp", 
                     game.getName(), commands[no++]));
+        if (game.isExists())
+            area.add(new SaveThumbnail(516, pos + 1, game));
         pos += 30;
     }
     
     area.run();
+    return turned;
+}
+
+
+static void deleteCommands(Commands &commands)
+{
+    for (Commands::iterator i = commands.begin(); i != commands.end(); i++)
+        delete *i;
+    commands.clear();
 }
 
 
 bool saveGame(Area *parentArea, Game *game)
 {
-    std::wstring path = getSavesPath();
-    
-    Area area;
-    area.add(parentArea, false);
+    SavesIndex index(getSavesPath());
     Font font(L"laudcn2.ttf", 14);
     bool saved = false;
+    int page = 0;
+    bool turned;
     
-    SavesList list;
-    Command **commands = new Command*[MAX_SLOTS];
-    for (int i = 0; i < MAX_SLOTS; i++) {
-        SavedGame sg(path + L"/" + toString(i) + L".sav");
-        list.push_back(sg);
-        commands[i] = new SaveCommand(*(--(list.end())), &font, 
-                &area, &saved, L"game " + toString(i+1), game);
-    }
-    
-    showListWindow(list, commands, msg(L"saveGame"), area, &font);
-
-    for (int i = 0; i < MAX_SLOTS; i++)
-        delete commands[i];
-    delete[] commands;
+    do {
+        Area area;
+        area.add(parentArea, false);
+        
+        // one more empty slot is always available
+        int count = index.getCount() + 1;
+        int pagesCnt = (count + SLOTS_PER_PAGE - 1) / SLOTS_PER_PAGE;
+        SavesList list;
+        Commands commands;
+        for (int i = page * SLOTS_PER_PAGE; 
+                (i < count) && (i < (page + 1) * SLOTS_PER_PAGE); i++) 
+        {
+            if (i < index.getCount())
+                list.push_back(index.getGame(i));
+            else
+                list.push_back(SavedGame(index.getFreeSlot()));
+            int slot = list.back().getSlot();
+            commands.push_back(new SaveCommand(list.back(), index, &font, 
+                    &area, &saved, L"game " + toString(slot + 1), game));
+        }
+        
+        turned = showListWindow(list, commands, msg(L"saveGame"), area, 
+                &font, page, pagesCnt);
+        deleteCommands(commands);
+    } while (turned);
    
     return saved;
 }
@@ -214,16 +556,14 @@ bool saveGame(Area *parentArea, Game *game)
 class LoadCommand: public Command
 {
     private:
-        SavedGame &savedGame;
+        std::wstring fileName;
         Area *parentArea;
-        bool *saved;
         Font *font;
-        std::wstring defaultName;
         Game **game;
 
     public:
-        LoadCommand(SavedGame &sg, Font *f, Area *area, Game **g): 
-            savedGame(sg)
+        LoadCommand(const std::wstring &name, Font *f, Area *area, Game **g): 
+            fileName(name)
         {
             parentArea = area;
             font = f;
@@ -233,7 +573,7 @@ class LoadCommand: public Command
     public:
         virtual void doAction() {
             try {
-                std::ifstream stream(toMbcs(savedGame.getFileName()).c_str(), 
+                std::ifstream stream(toMbcs(fileName).c_str(), 
                         std::ifstream::in | std::ifstream::binary);
                 if (stream.fail())
                     throw Exception(L"Error opening save file");
@@ -254,32 +594,33 @@ class LoadCommand: public Command
 
 Game* loadGame(Area *parentArea)
 {
-    std::wstring path = getSavesPath();
-    
-    Area area;
-    area.add(parentArea, false);
+    SavesIndex index(getSavesPath());
     Font font(L"laudcn2.ttf", 14);
-    
     Game *newGame = NULL;
+    int page = 0;
+    bool turned;
     
-    SavesList list;
-    Command **commands = new Command*[MAX_SLOTS];
-    for (int i = 0; i < MAX_SLOTS; i++) {
-        SavedGame sg(path + L"/" + toString(i) + L".sav");
-        list.push_back(sg);
-        if (sg.isExists())
-            commands[i] = new LoadCommand(*(--(list.end())), &font, &area, 
-                    &newGame);
-        else
-            commands[i] = NULL;
-    }
+    do {
+        Area area;
+        area.add(parentArea, false);
+        
+        int count = index.getCount();
+        int pagesCnt = (count + SLOTS_PER_PAGE - 1) / SLOTS_PER_PAGE;
+        SavesList list;
+        Commands commands;
+        for (int i = page * SLOTS_PER_PAGE; 
+                (i < count) && (i < (page + 1) * SLOTS_PER_PAGE); i++) 
+        {
+            const SavedGame &sg = index.getGame(i);
+            list.push_back(sg);
+            commands.push_back(new LoadCommand(index.getFileName(
+                        sg.getSlot()), &font, &area, &newGame));
+        }
     
-    showListWindow(list, commands, msg(L"loadGame"), area, &font);
-
-    for (int i = 0; i < MAX_SLOTS; i++)
-        delete commands[i];
-    delete[] commands;
+        turned = showListWindow(list, commands, msg(L"loadGame"), area, 
+                &font, page, pagesCnt);
+        deleteCommands(commands);
+    } while (turned);
    
     return newGame;
 }
-
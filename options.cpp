@@ -10,22 +10,28 @@ class OptionsChangedCommand: public Command
     private:
         bool &fullscreen;
         bool &niceCursor;
+        bool &accelerated;
         float &volume;
         Area *area;
     
     public:
-        OptionsChangedCommand(Area *a, bool &fs, bool &ns, float &v): 
-            fullscreen(fs), niceCursor(ns), volume(v) {
+        OptionsChangedCommand(Area *a, bool &fs, bool &ns, bool &ac, 
+                float &v): 
+            fullscreen(fs), niceCursor(ns), accelerated(ac), volume(v) {
             area = a;
         };
 
         virtual void doAction() {
             bool oldFullscreen = (getStorage()->get(L"fullscreen", 1) != 0);
             bool oldCursor = (getStorage()->get(L"niceCursor", 1) != 0);
+            bool oldAccelerated = (getStorage()->get(L"accelerated", 0) != 0);
             float oldVolume = (float)getStorage()->get(L"volume", 20) / 100.0f;
-            if (fullscreen != oldFullscreen) {
+            if ((fullscreen != oldFullscreen) || 
+                    (accelerated != oldAccelerated)) {
                 getStorage()->set(L"fullscreen", fullscreen);
-                screen.setMode(VideoMode(800, 600, 24, fullscreen));
+                getStorage()->set(L"accelerated", accelerated);
+                screen.setMode(VideoMode(800, 600, 24, fullscreen, 
+                            accelerated));
             }
 #ifndef __APPLE__
             if (niceCursor != oldCursor) {
@@ -37,7 +43,6 @@ class OptionsChangedCommand: public Command
                 getStorage()->set(L"volume", (int)(volume * 100.0f));
                 sound->setVolume(volume);
             }
-            getStorage()->flush();
             area->finishEventLoop();
         };
 };
@@ -58,6 +63,7 @@ void showOptionsWindow(Area *parentArea)
 
     bool fullscreen = (getStorage()->get(L"fullscreen", 1) != 0);
     bool niceCursor = (getStorage()->get(L"niceCursor", 1) != 0);
+    bool accelerated = (getStorage()->get(L"accelerated", 0) != 0);
     float volume = ((float)getStorage()->get(L"volume", 20)) / 100.0f;
     
     Area area;
@@ -70,13 +76,15 @@ void showOptionsWindow(Area *parentArea)
 #ifndef __APPLE__
     OPTION(280, L"niceCursor", niceCursor);
 #endif
+    OPTION(300, L"accelerated", accelerated);
     
     area.add(new Label(&font, 265, 330, 300, 20, Label::ALIGN_LEFT,
                 Label::ALIGN_MIDDLE, 255,255,255, msg(L"volume")));
     area.add(new Slider(360, 332, 160, 16, volume));
     
     ExitCommand exitCmd(area);
-    OptionsChangedCommand okCmd(&area, fullscreen, niceCursor, volume);
+    OptionsChangedCommand okCmd(&area, fullscreen, niceCursor, accelerated,
+            volume);
     area.add(new Button(315, 390, 85, 25, &font, 255,255,0, L"blue.bmp", 
                 msg(L"ok"), &okCmd));
     area.add(new Button(405, 390, 85, 25, &font, 255,255,0, L"blue.bmp", 
@@ -1,84 +1,196 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <wchar.h>
+#include <wctype.h>
 #include <iostream>
 #include <string>
 #include <list>
 #include "puzgen.h"
+#include "solver.h"
+#include "instrument.h"
 #include "exceptions.h"
 #include "utils.h"
+#include "main.h"
+
+
+#define ALL_CELLS   ((1 << PUZZLE_SIZE) - 1)
 
 
 
 Possibilities::Possibilities()
 {
+    subsets = false;
     reset();
 }
 
 Possibilities::Possibilities(std::istream &stream)
 {
+    subsets = false;
+    maxCascade = 0;
     for (int row = 0; row < PUZZLE_SIZE; row++)
         for (int col = 0; col < PUZZLE_SIZE; col++)
             for (int element = 0; element < PUZZLE_SIZE; element++)
                 pos[col][row][element] = readInt(stream);
+    updateColumns();
 }
 
 void Possibilities::reset()
 {
+    maxCascade = 0;
     for (int i = 0; i < PUZZLE_SIZE; i++)
         for (int j = 0; j < PUZZLE_SIZE; j++)
             for (int k = 0; k < PUZZLE_SIZE; k++)
                 pos[i][j][k] = k + 1;
+    memset(cols, ALL_CELLS, sizeof(cols));
 }
 
-void Possibilities::checkSingles(int row)
+void Possibilities::updateColumns()
 {
-    int cellsCnt[PUZZLE_SIZE];   // count of elements in cells
-    int elsCnt[PUZZLE_SIZE];     // total count of elements in row
-    int elements[PUZZLE_SIZE];   // one element of each cell
-    int elCells[PUZZLE_SIZE];    // one cell of each element
+    memset(cols, 0, sizeof(cols));
+    for (int col = 0; col < PUZZLE_SIZE; col++)
+        for (int row = 0; row < PUZZLE_SIZE; row++)
+            for (int element = 0; element < PUZZLE_SIZE; element++)
+                if (pos[col][row][element])
+                    cols[row][element] |= 1 << col;
+}
 
-    memset(cellsCnt, 0, sizeof(cellsCnt));
-    memset(elsCnt, 0, sizeof(elsCnt));
-    memset(elements, 0, sizeof(elements));
-    memset(elCells, 0, sizeof(elCells));
-    
-    // check if there is only one element left in cell(col, row)
+
+static inline bool isSingle(int mask)
+{
+    return mask && ! (mask & (mask - 1));
+}
+
+static inline int countBits(int mask)
+{
+    int cnt = 0;
+    for (; mask; mask &= mask - 1)
+        cnt++;
+    return cnt;
+}
+
+static inline int getBit(int mask)
+{
+    int bit = 0;
+    while (! (mask & (1 << bit)))
+        bit++;
+    return bit;
+}
+
+void Possibilities::getCells(int row, int cells[PUZZLE_SIZE])
+{
     for (int col = 0; col < PUZZLE_SIZE; col++)
-        for (int i = 0; i < PUZZLE_SIZE; i++) {
-            if (pos[col][row][i]) {
-                elsCnt[i]++;
-                elCells[i] = col;
-                cellsCnt[col]++;
-                elements[col] = i + 1;
-            }
+        cells[col] = 0;
+    for (int el = 0; el < PUZZLE_SIZE; el++)
+        for (int col = 0; col < PUZZLE_SIZE; col++)
+            if (cols[row][el] & (1 << col))
+                cells[col] |= 1 << el;
+}
+
+bool Possibilities::removeElements(int row, int elements, int cells)
+{
+    bool changed = false;
+    for (int el = 0; el < PUZZLE_SIZE; el++) {
+        int c = cols[row][el] & cells;
+        if ((elements & (1 << el)) && c) {
+            for (int col = 0; col < PUZZLE_SIZE; col++)
+                if (c & (1 << col))
+                    pos[col][row][el] = 0;
+            cols[row][el] &= ~c;
+            changed = true;
         }
+    }
+    return changed;
+}
+
+bool Possibilities::checkRowSingles(int row)
+{
+    int cells[PUZZLE_SIZE];      // elements of each cell
+    int els[PUZZLE_SIZE];        // cells of each element
+
+    getCells(row, cells);
+    for (int el = 0; el < PUZZLE_SIZE; el++)
+        els[el] = cols[row][el];
 
     bool changed = false;
     
     // check for cells with single element
-    for (int col = 0; col < PUZZLE_SIZE; col++) {
-        if ((cellsCnt[col] == 1) && (elsCnt[elements[col] - 1] != 1)) {
+    for (int col = 0; col < PUZZLE_SIZE; col++)
+        if (isSingle(cells[col]) && ! isSingle(els[getBit(cells[col])])) {
             // there is only one element in cell but it used somewhere else
-            int e = elements[col] - 1;
-            for (int i = 0; i < PUZZLE_SIZE; i++)
-                if (i != col)
-                    pos[i][row][e] = 0;
+            removeElements(row, cells[col], ALL_CELLS & ~(1 << col));
             changed = true;
         }
-    }
 
     // check for single element without exclusive cell
     for (int el = 0; el < PUZZLE_SIZE; el++)
-        if ((elsCnt[el] == 1) && (cellsCnt[elCells[el]] != 1)) {
-            int col = elCells[el];
-            for (int i = 0; i < PUZZLE_SIZE; i++)
-                if (i != el)
-                    pos[col][row][i] = 0;
+        if (isSingle(els[el]) && ! isSingle(cells[getBit(els[el])])) {
+            removeElements(row, ALL_CELLS & ~(1 << el), els[el]);
             changed = true;
         }
-    
-    if (changed)
-        checkSingles(row);
+
+    return changed;
+}
+
+bool Possibilities::removeSubset(int row, int set, int other, bool hidden)
+{
+    if (hidden)
+        return removeElements(row, ALL_CELLS & ~set, other);
+    else
+        return removeElements(row, other, ALL_CELLS & ~set);
+}
+
+bool Possibilities::checkSubsets(int row, int masks[PUZZLE_SIZE], 
+        bool hidden)
+{
+    // only masks with two or three bits make pairs and triples
+    int cand[PUZZLE_SIZE];
+    int cnt = 0;
+    for (int i = 0; i < PUZZLE_SIZE; i++) {
+        int bits = countBits(masks[i]);
+        if ((bits == 2) || (bits == 3))
+            cand[cnt++] = i;
+    }
+
+    for (int i = 0; i < cnt; i++)
+        for (int j = i + 1; j < cnt; j++) {
+            int set = (1 << cand[i]) | (1 << cand[j]);
+            int other = masks[cand[i]] | masks[cand[j]];
+            int bits = countBits(other);
+            if ((bits == 2) && removeSubset(row, set, other, hidden))
+                return true;
+            if (bits > 3)
+                continue;
+            for (int k = j + 1; k < cnt; k++)
+                if ((countBits(other | masks[cand[k]]) == 3) && 
+                        removeSubset(row, set | (1 << cand[k]), 
+                            other | masks[cand[k]], hidden))
+                    return true;
+        }
+
+    return false;
+}
+
+bool Possibilities::checkSubsets(int row)
+{
+    int cells[PUZZLE_SIZE];      // elements of each cell
+    int els[PUZZLE_SIZE];        // cells of each element
+
+    getCells(row, cells);
+    for (int el = 0; el < PUZZLE_SIZE; el++)
+        els[el] = cols[row][el];
+
+    return checkSubsets(row, cells, false) || checkSubsets(row, els, true);
+}
+
+void Possibilities::checkSingles(int row)
+{
+    int cascade = 0;
+    while (checkRowSingles(row) || (subsets && checkSubsets(row))) {
+        cascade++;
+        if (cascade > maxCascade)
+            maxCascade = cascade;
+    }
+    INSTR_CASCADE(cascade);
 }
 
 void Possibilities::exclude(int col, int row, int element)
@@ -87,6 +199,7 @@ void Possibilities::exclude(int col, int row, int element)
         return;
 
     pos[col][row][element - 1] = 0;
+    cols[row][element - 1] &= ~(1 << col);
 
     checkSingles(row);
 }
@@ -94,14 +207,16 @@ void Possibilities::exclude(int col, int row, int element)
 void Possibilities::set(int col, int row, int element)
 {
     for (int i = 0; i < PUZZLE_SIZE; i++)
-        if ((i != element - 1))
+        if ((i != element - 1)) {
             pos[col][row][i] = 0;
-        else
+            cols[row][i] &= ~(1 << col);
+        } else
             pos[col][row][i] = element;
     
     for (int j = 0; j < PUZZLE_SIZE; j++)
         if (j != col)
             pos[j][row][element - 1] = 0;
+    cols[row][element - 1] = 1 << col;
     
     checkSingles(row);
 }
@@ -182,9 +297,21 @@ void Possibilities::print()
     }
 }
 
+int Possibilities::countPossible()
+{
+    int cnt = 0;
+    for (int i = 0; i < PUZZLE_SIZE; i++)
+        for (int j = 0; j < PUZZLE_SIZE; j++)
+            for (int k = 0; k < PUZZLE_SIZE; k++)
+                if (pos[i][j][k])
+                    cnt++;
+    return cnt;
+}
+
 void Possibilities::makePossible(int col, int row, int element)
 {
     pos[col][row][element-1] = element;
+    cols[row][element-1] |= 1 << col;
 }
 
 void Possibilities::save(std::ostream &stream)
@@ -195,39 +322,74 @@ void Possibilities::save(std::ostream &stream)
                 writeInt(stream, pos[col][row][element]);
 }
 
+#define PACKED_SIZE ((PUZZLE_SIZE * PUZZLE_SIZE * PUZZLE_SIZE + 7) / 8)
+
+// one bit per element, set if element is possible
+void Possibilities::savePacked(std::ostream &stream)
+{
+    unsigned char buf[PACKED_SIZE];
+    memset(buf, 0, sizeof(buf));
+    int bit = 0;
+    for (int row = 0; row < PUZZLE_SIZE; row++)
+        for (int col = 0; col < PUZZLE_SIZE; col++)
+            for (int element = 0; element < PUZZLE_SIZE; element++, bit++)
+                if (pos[col][row][element])
+                    buf[bit / 8] |= 1 << (bit % 8);
+    stream.write((char*)buf, sizeof(buf));
+}
+
+void Possibilities::loadPacked(std::istream &stream)
+{
+    unsigned char buf[PACKED_SIZE];
+    stream.read((char*)buf, sizeof(buf));
+    if (stream.fail())
+        throw Exception(L"Error reading possibilities");
+    int bit = 0;
+    for (int row = 0; row < PUZZLE_SIZE; row++)
+        for (int col = 0; col < PUZZLE_SIZE; col++)
+            for (int element = 0; element < PUZZLE_SIZE; element++, bit++)
+                pos[col][row][element] = (buf[bit / 8] & (1 << (bit % 8))) ?
+                    element + 1 : 0;
+    updateColumns();
+}
+
 
 static void shuffle(short arr[PUZZLE_SIZE])
 {
-    int a, b, c;
-    
-    for (int i = 0; i < 30; i++) {
-        a = (int)(((double)PUZZLE_SIZE)*rand()/(RAND_MAX+1.0));
-        if ((a < 0) || (a >= PUZZLE_SIZE)) {
-            std::cerr << "Index error" << std::endl;
-            exit(1);
-        }
-        b = (int)(((double)PUZZLE_SIZE)*rand()/(RAND_MAX+1.0));        
-        if ((b < 0) || (b >= PUZZLE_SIZE)) {
-            std::cerr << "Index error" << std::endl;
-            exit(1);
-        }
-        c = arr[a];
-        arr[a] = arr[b];
-        arr[b] = c;
+    for (int i = PUZZLE_SIZE - 1; i > 0; i--) {
+        int j = rndGen.genInt(i + 1);
+        short c = arr[i];
+        arr[i] = arr[j];
+        arr[j] = c;
     }
 }
 
 
-static bool canSolve(SolvedPuzzle &puzzle, Rules &rules)
+/// How generator checks that rules solve puzzle.
+typedef enum {
+    SOLVE_SINGLES,      /// possibilities with single checks, as player
+    SOLVE_SUBSETS,      /// possibilities with pairs and triples
+    SOLVE_MASKS         /// single checks on columns masks, fastest
+} SolveMode;
+
+
+static bool canSolve(SolvedPuzzle &puzzle, Rules &rules, SolveMode mode)
 {
+    if (SOLVE_MASKS == mode)
+        return propagateRules(rules);
+
+    INSTR_SPAN("canSolve");
     Possibilities pos;
+    pos.setSubsets(SOLVE_SUBSETS == mode);
     bool changed = false;
+    int passes = 0;
     
     do {
         changed = false;
+        passes++;
         for (Rules::iterator i = rules.begin(); i != rules.end(); i++) {
             Rule *rule = *i;
-            if (rule->apply(pos)) {
+            if (INSTR_APPLY(rule, pos)) {
                 changed = true;
                 if (! pos.isValid(puzzle)) {
 std::cout << "after error:" << std::endl;
@@ -240,91 +402,318 @@ pos.print();
     } while (changed);
 
     bool res = pos.isSolved();
+    INSTR_SOLVED(passes, res);
     return res;
 }
 
 
-static void removeRules(SolvedPuzzle &puzzle, Rules &rules)
+/// Remove rules which are not needed to solve puzzle.  Rule needed once
+/// stays needed when other rules are removed, so single pass is enough.
+static void removeRules(SolvedPuzzle &puzzle, Rules &rules, 
+        SolveMode mode)
 {
-    bool possible;
-    
-    do {
-        possible = false;
-        for (Rules::iterator i = rules.begin(); i != rules.end(); i++) {
-            Rule *rule = *i;
-            Rules excludedRules = rules;
-            excludedRules.remove(rule);
-            if (canSolve(puzzle, excludedRules)) {
-                possible = true;
-                rules.remove(rule);
-                delete rule;
-                break;
-            }
-        }
-    } while (possible);
+    INSTR_SPAN("removeRules");
+    Rules::iterator i = rules.begin();
+    while (i != rules.end()) {
+        Rule *rule = *i;
+        i = rules.erase(i);
+        if (canSolve(puzzle, rules, mode))
+            delete rule;
+        else
+            rules.insert(i, rule);
+    }
 }
 
 
-static void genRules(SolvedPuzzle &puzzle, Rules &rules)
+static bool hasRule(Rules &rules, Rule *rule)
 {
-    bool rulesDone = false;
+    unsigned int key = rule->getKey();
+    for (Rules::iterator i = rules.begin(); i != rules.end(); i++) 
+        if ((*i)->getKey() == key)
+            return true;
+    return false;
+}
+
+
+#define KEYS_SET_SIZE 1024
 
+/// Set of rule keys.  Open addressing hash table, big enough
+/// for rules of any puzzle.
+class RuleKeys
+{
+    private:
+        unsigned int slots[KEYS_SET_SIZE];  /// key + 1, 0 for empty slot
+        int count;
+
+    public:
+        RuleKeys() { clear(); };
+
+    public:
+        /// Add key.  Returns false if key is already in set.
+        bool add(unsigned int key);
+        void clear();
+};
+
+bool RuleKeys::add(unsigned int key)
+{
+    if (count >= KEYS_SET_SIZE / 2)
+        throw Exception(L"Too many rules");
+    unsigned int slot = (key * 2654435761U) % KEYS_SET_SIZE;
+    while (slots[slot]) {
+        if (slots[slot] == key + 1)
+            return false;
+        slot = (slot + 1) % KEYS_SET_SIZE;
+    }
+    slots[slot] = key + 1;
+    count++;
+    return true;
+}
+
+void RuleKeys::clear()
+{
+    memset(slots, 0, sizeof(slots));
+    count = 0;
+}
+
+
+/// Generator gives up when so many rules in a row are already in puzzle.
+#define MAX_DUPLICATE_RULES 1000
+
+/// Add random rules until puzzle can be solved.  Returns false if
+/// rules of given kinds can't solve puzzle.
+static bool genRules(SolvedPuzzle &puzzle, Rules &rules, 
+        const int weights[RULE_KINDS_CNT], SolveMode mode)
+{
+    INSTR_SPAN("genRules");
+    RuleKeys keys;
+    for (Rules::iterator i = rules.begin(); i != rules.end(); i++)
+        keys.add((*i)->getKey());
+
+    int duplicates = 0;
     do {
-        Rule *rule = genRule(puzzle);
-        if (rule) {
-            std::wstring s = rule->getAsText();
-            for (std::list<Rule*>::iterator i = rules.begin(); 
-                    i != rules.end(); i++) 
-                if ((*i)->getAsText() == s) {
-                    delete rule;
-                    rule = NULL;
-                    break;
-                }
-            if (rule) {
-//printf("adding rule %s\n", rule->getAsText().c_str());
-                rules.push_back(rule);
-                rulesDone = canSolve(puzzle, rules);
-            }
+        Rule *rule = genRule(puzzle, weights);
+        if (! keys.add(rule->getKey())) {
+            delete rule;
+            if (++duplicates >= MAX_DUPLICATE_RULES)
+                return false;
+        } else {
+            duplicates = 0;
+            rules.push_back(rule);
         }
-    } while (! rulesDone);
+    } while (duplicates || ! canSolve(puzzle, rules, mode));
+
+    return true;
 }
 
 
-/*static void printPuzzle(SolvedPuzzle &puzzle)
+static void genSolvedPuzzle(SolvedPuzzle &puzzle)
 {
     for (int i = 0; i < PUZZLE_SIZE; i++) {
-        char prefix = 'A' + i;
-        for (int j = 0; j < PUZZLE_SIZE; j++) {
-            if (j)
-                std::cout << "  ";
-            std::cout << prefix << puzzle[i][j];
-        }
-        std::cout << std::endl;
+        for (int j = 0; j < PUZZLE_SIZE; j++) 
+            puzzle[i][j] = j + 1;
+        shuffle(puzzle[i]);
     }
 }
 
 
-static void printRules(Rules &rules)
+static void genPuzzle(SolvedPuzzle &puzzle, Rules &rules, SolveMode mode)
 {
-    for (Rules::iterator i = rules.begin(); i != rules.end(); i++)
-        std::cout << (*i)->getAsText() << std::endl;;
-}*/
+    INSTR_SPAN("genPuzzle");
+    static const int weights[RULE_KINDS_CNT] = { 4, 4, 1, 2, 3 };
+    
+    genSolvedPuzzle(puzzle);
+    genRules(puzzle, rules, weights, mode);
+    removeRules(puzzle, rules, mode);
+}
 
 
 void genPuzzle(SolvedPuzzle &puzzle, Rules &rules)
 {
-    srand(time(NULL));
+    genPuzzle(puzzle, rules, SOLVE_SINGLES);
+}
 
-    for (int i = 0; i < PUZZLE_SIZE; i++) {
-        for (int j = 0; j < PUZZLE_SIZE; j++) 
-            puzzle[i][j] = j + 1;
-        shuffle(puzzle[i]);
+
+static void clearRules(Rules &rules)
+{
+    for (Rules::iterator i = rules.begin(); i != rules.end(); i++)
+        delete *i;
+    rules.clear();
+}
+
+
+/// Check if rules fit into hints area of game screen.
+static bool fitsScreen(Rules &rules)
+{
+    int horRules, verRules;
+    getHintsQty(rules, verRules, horRules);
+    return (horRules <= MAX_HORIZ_RULES) && (verRules <= MAX_VERT_RULES);
+}
+
+
+void genPuzzle(SolvedPuzzle &puzzle, Rules &rules, PuzzleId id)
+{
+    Random saved(rndGen);
+    rndGen.setSeed(id);
+    SolveMode mode = (id & PUZZLE_ID_SUBSETS) ? SOLVE_SUBSETS : 
+        SOLVE_SINGLES;
+
+    do {
+        clearRules(rules);
+        genPuzzle(puzzle, rules, mode);
+    } while (! fitsScreen(rules));
+
+    rndGen = saved;
+}
+
+
+PuzzleId genPuzzleId(bool subsets)
+{
+    PuzzleId id = rndGen.genInt64() & ~PUZZLE_ID_SUBSETS;
+    if (subsets)
+        id |= PUZZLE_ID_SUBSETS;
+    return id;
+}
+
+
+static const wchar_t *idDigits = L"0123456789ABCDEFGHJKMNPQRSTVWXYZ";
+
+std::wstring puzzleIdToString(PuzzleId id)
+{
+    wchar_t buf[PUZZLE_ID_LENGTH];
+    int len = 0;
+    do {
+        buf[PUZZLE_ID_LENGTH - ++len] = idDigits[id & 31];
+        id >>= 5;
+    } while (id);
+    return std::wstring(buf + PUZZLE_ID_LENGTH - len, len);
+}
+
+
+PuzzleId puzzleIdFromString(const std::wstring &str)
+{
+    PuzzleId id = 0;
+    int len = 0;
+    for (unsigned int i = 0; i < str.length(); i++) {
+        wchar_t c = towupper(str[i]);
+        if (L'-' == c)
+            continue;
+        if (L'O' == c)
+            c = L'0';
+        else if ((L'I' == c) || (L'L' == c))
+            c = L'1';
+        const wchar_t *d = wcschr(idDigits, c);
+        if ((! c) || (! d) || (id >> 59) || (++len > PUZZLE_ID_LENGTH))
+            throw Exception(L"Invalid puzzle ID");
+        id = (id << 5) | (d - idDigits);
+    }
+    if (! len)
+        throw Exception(L"Invalid puzzle ID");
+    return id;
+}
+
+
+/// Get distance from difficulty of puzzle to target difficulty band.
+/// Returns -1 if puzzle can't be solved.
+static int getDistance(Rules &rules, const DifficultyTarget &target)
+{
+    int chain;
+    if (! propagateRules(rules, &chain))
+        return -1;
+    if (chain < target.minChain)
+        return target.minChain - chain;
+    if (chain > target.maxChain)
+        return chain - target.maxChain;
+    return 0;
+}
+
+
+/// Check if puzzles of target difficulty can be made.  Near, under and
+/// between rules are the same for puzzle and its mirror, so only direction
+/// and open rules can make solution single.
+static bool isValidTarget(const DifficultyTarget &target)
+{
+    for (int i = 0; i < RULE_KINDS_CNT; i++)
+        if (target.kindWeights[i] < 0)
+            return false;
+    return (target.minChain <= target.maxChain) && 
+        ((target.kindWeights[Rule::DIRECTION_RULE] > 0) ||
+         (target.kindWeights[Rule::OPEN_RULE] > 0));
+}
+
+
+static Rules::iterator getRandomRule(Rules &rules)
+{
+    Rules::iterator i = rules.begin();
+    for (int no = rndGen.genInt(rules.size()); no > 0; no--)
+        i++;
+    return i;
+}
+
+
+static bool genTargetPuzzle(SolvedPuzzle &puzzle, Rules &rules, 
+        const DifficultyTarget &target, int maxSteps)
+{
+    INSTR_SPAN("genTargetPuzzle");
+    genSolvedPuzzle(puzzle);
+    int step = 0;
+    for (;;) {
+        if (! genRules(puzzle, rules, target.kindWeights, SOLVE_MASKS))
+            return false;
+        removeRules(puzzle, rules, SOLVE_MASKS);
+        if (fitsScreen(rules))
+            break;
+        if (++step >= maxSteps)
+            return false;
+        clearRules(rules);
+    }
+    int distance = getDistance(rules, target);
+
+    // local search: add, drop or replace random rule while puzzle
+    // stays solvable, fits the screen and doesn't go away from target band
+    for (; distance && (step < maxSteps); step++) {
+        Rules candidate(rules);
+        Rule *dropped = NULL;
+        Rule *added = NULL;
+        
+        int move = rndGen.genInt(3);
+        if ((move != 0) && (candidate.size() > 1)) {
+            Rules::iterator i = getRandomRule(candidate);
+            dropped = *i;
+            candidate.erase(i);
+        }
+        if (move != 1) {
+            added = genRule(puzzle, target.kindWeights);
+            if (hasRule(candidate, added)) {
+                delete added;
+                continue;
+            }
+            candidate.push_back(added);
+        }
+
+        int d = fitsScreen(candidate) ? getDistance(candidate, target) : -1;
+        if ((d >= 0) && (d <= distance)) {
+            rules.swap(candidate);
+            distance = d;
+            delete dropped;
+        } else
+            delete added;
     }
 
-    genRules(puzzle, rules);
-    removeRules(puzzle, rules);
-//printPuzzle(puzzle);
-//printRules(rules);
+    return ! distance;
+}
+
+
+bool genPuzzle(SolvedPuzzle &puzzle, Rules &rules, 
+        const DifficultyTarget &target, PuzzleId seed, int maxSteps)
+{
+    if (! isValidTarget(target))
+        return false;
+
+    Random saved(rndGen);
+    rndGen.setSeed(seed);
+    bool reached = genTargetPuzzle(puzzle, rules, target, maxSteps);
+    rndGen = saved;
+    return reached;
 }
 
 
@@ -379,18 +768,3 @@ Rule* getRule(Rules &rules, int no)
     throw Exception(L"Rule is not found");
 }
 
-
-/*int main(int argc, char *argv[])
-{
-    srand(time(NULL));
-    
-    Rules rules;
-    Puzzle puzzle;
-    
-    genPuzzle(puzzle, rules);
-    printPuzzle(puzzle);
-    printRules(rules);
-    
-    return 0;
-}*/
-
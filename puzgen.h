@@ -18,6 +18,11 @@ class Possibilities
 {
     private:
         short pos[PUZZLE_SIZE][PUZZLE_SIZE][PUZZLE_SIZE];
+        /// Columns where element of row is possible, one bit per column.
+        /// Follows pos on every change.
+        unsigned char cols[PUZZLE_SIZE][PUZZLE_SIZE];
+        int maxCascade;
+        bool subsets;
     
     public:
         Possibilities();
@@ -30,13 +35,35 @@ class Possibilities
         bool isDefined(int col, int row);
         int getDefined(int col, int row);
         int getPosition(int row, int element);
+        int getColumns(int row, int element) { 
+            return cols[row][element - 1]; 
+        };
         bool isSolved();
         void print();
         bool isValid(SolvedPuzzle &puzzle);
         void makePossible(int col, int row, int element);
         void save(std::ostream &stream);
+        void savePacked(std::ostream &stream);
+        void loadPacked(std::istream &stream);
         void reset();
         void checkSingles(int row);
+        int countPossible();
+        int getMaxCascade() { return maxCascade; };
+
+        /// Enable naked and hidden pairs and triples in checkSingles().
+        /// Stronger propagation lets generator solve puzzles with less
+        /// rules.  Player's possibilities always use singles only.
+        void setSubsets(bool enable) { subsets = enable; };
+        bool getSubsets() { return subsets; };
+
+    private:
+        void updateColumns();
+        void getCells(int row, int cells[PUZZLE_SIZE]);
+        bool removeElements(int row, int elements, int cells);
+        bool checkRowSingles(int row);
+        bool removeSubset(int row, int set, int other, bool hidden);
+        bool checkSubsets(int row, int masks[PUZZLE_SIZE], bool hidden);
+        bool checkSubsets(int row);
 };
 
 
@@ -48,6 +75,24 @@ class Rule
             SHOW_HORIZ,
             SHOW_NOTHING
         } ShowOptions;
+
+        typedef enum {
+            NEAR_RULE,
+            DIRECTION_RULE,
+            OPEN_RULE,
+            UNDER_RULE,
+            BETWEEN_RULE
+        } Kind;
+
+        /// Structure of rule.  Things are numbered as 
+        /// row * PUZZLE_SIZE + element - 1.
+        typedef struct {
+            Kind kind;
+            int thing1;         /// first thing
+            int thing2;         /// second thing, unused by open rule
+            int center;         /// center thing of between rule
+            int col;            /// column of open rule
+        } Info;
     
     public:
         virtual ~Rule() { };
@@ -59,15 +104,77 @@ class Rule
         virtual ShowOptions getShowOpts() { return SHOW_NOTHING; };
         virtual void draw(int x, int y, IconSet &iconSet, bool highlight) = 0;
         virtual void save(std::ostream &stream) = 0;
+        virtual Info getInfo() = 0;
+
+        /// Get key which is equal for rules with the same meaning.
+        unsigned int getKey() { return getRuleKey(getInfo()); };
+
+        /// Get key of rule with given structure.
+        static unsigned int getRuleKey(const Info &info);
 };
 
 
 typedef std::list<Rule*> Rules;
 
 
+#define RULE_KINDS_CNT 5
+
+
+/// Wanted difficulty of generated puzzle.
+typedef struct {
+    int minChain;                       /// shortest allowed chain of
+                                        /// dependent deductions
+    int maxChain;                       /// longest allowed chain
+    int kindWeights[RULE_KINDS_CNT];    /// relative frequency of rule 
+                                        /// kinds, indexed by Rule::Kind
+} DifficultyTarget;
+
+
+/// Puzzle ID.  Seed of generator which makes the puzzle, top bit
+/// enables pairs and triples propagation while puzzle is made.
+typedef unsigned long long PuzzleId;
+
+#define PUZZLE_ID_SUBSETS   0x8000000000000000ULL
+
+/// Longest puzzle ID in text form.
+#define PUZZLE_ID_LENGTH    13
+
+/// Most hints which fit to the game screen.
+#define MAX_HORIZ_RULES     24
+#define MAX_VERT_RULES      15
+
+
 void genPuzzle(SolvedPuzzle &puzzle, Rules &rules);
+
+/// Generate puzzle defined by ID.  The same ID always makes the same
+/// puzzle, independent of state of global random generator.
+/// Puzzle always fits into hints area.
+void genPuzzle(SolvedPuzzle &puzzle, Rules &rules, PuzzleId id);
+
+/// Get ID for new random puzzle.
+/// \param subsets generator uses pairs and triples to solve puzzle
+PuzzleId genPuzzleId(bool subsets=false);
+
+/// Convert puzzle ID to text, up to PUZZLE_ID_LENGTH characters of
+/// Crockford's base32.
+std::wstring puzzleIdToString(PuzzleId id);
+
+/// Convert text to puzzle ID.  Case and dashes are ignored.
+/// Throws exception if text is not a puzzle ID.
+PuzzleId puzzleIdFromString(const std::wstring &str);
+
+/// Generate puzzle with chain length in target band which fits into
+/// hints area.  Returns false if target can't be reached, rules are
+/// left for caller to delete anyway.
+/// Puzzle is checked on columns masks, without pairs and triples.
+/// The same seed, target and steps always make the same puzzle,
+/// so puzzle bank needs to keep only seeds of its target.
+bool genPuzzle(SolvedPuzzle &puzzle, Rules &rules, 
+        const DifficultyTarget &target, PuzzleId seed, int maxSteps=1000);
 void openInitial(Possibilities &possib, Rules &rules);
 Rule* genRule(SolvedPuzzle &puzzle);
+Rule* genRule(SolvedPuzzle &puzzle, Rule::Kind kind);
+Rule* genRule(SolvedPuzzle &puzzle, const int weights[RULE_KINDS_CNT]);
 void getHintsQty(Rules &rules, int &vert, int &horiz);
 Rule* getRule(Rules &rules, int no);
 
@@ -38,28 +38,34 @@ void Puzzle::reset()
 void Puzzle::draw()
 {
     for (int i = 0; i < PUZZLE_SIZE; i++)
-        for (int j = 0; j < PUZZLE_SIZE; j++)
-            drawCell(i, j, true);
+        drawRow(i, true);
 }
-    
-void Puzzle::drawCell(int col, int row, bool addToUpdate)
+
+int Puzzle::getCellBlits(int col, int row, IconSet::Blit *blits)
 {
     int posX = FIELD_OFFSET_X + col * (FIELD_TILE_WIDTH + FIELD_GAP_X);
     int posY = FIELD_OFFSET_Y + row * (FIELD_TILE_HEIGHT + FIELD_GAP_Y);
+    int cnt = 0;
 
     if (possib->isDefined(col, row)) {
         int element = possib->getDefined(col, row);
-        if (element > 0)
-            screen.draw(posX, posY, iconSet.getLargeIcon(row, element, 
-                        (hCol == col) && (hRow == row)));
+        if (element > 0) {
+            IconSet::Blit b = { &iconSet.getLargeIcon(row, element, 
+                        (hCol == col) && (hRow == row)), posX, posY };
+            blits[cnt++] = b;
+        }
     } else {
-        screen.draw(posX, posY, iconSet.getEmptyFieldIcon());
+        IconSet::Blit b = { &iconSet.getEmptyFieldIcon(), posX, posY };
+        blits[cnt++] = b;
         int x = posX;
         int y = posY + (FIELD_TILE_HEIGHT / 6);
         for (int i = 0; i < 6; i++) {
-            if (possib->isPossible(col, row, i + 1))
-                screen.draw(x, y, iconSet.getSmallIcon(row, i + 1, 
-                            (hCol == col) && (hRow == row) && (i + 1 == subHNo)));
+            if (possib->isPossible(col, row, i + 1)) {
+                IconSet::Blit b = { &iconSet.getSmallIcon(row, i + 1, 
+                            (hCol == col) && (hRow == row) && 
+                            (i + 1 == subHNo)), x, y };
+                blits[cnt++] = b;
+            }
             if (i == 2) {
                 x = posX;
                 y += (FIELD_TILE_HEIGHT / 3);
@@ -67,16 +73,35 @@ void Puzzle::drawCell(int col, int row, bool addToUpdate)
                 x += (FIELD_TILE_WIDTH / 3);
         }
     }
+    return cnt;
+}
+    
+void Puzzle::drawCell(int col, int row, bool addToUpdate)
+{
+    IconSet::Blit blits[PUZZLE_SIZE + 1];
+    iconSet.drawBatch(blits, getCellBlits(col, row, blits));
+
     if (addToUpdate)
-        screen.addRegionToUpdate(posX, posY, FIELD_TILE_WIDTH, 
-                FIELD_TILE_HEIGHT);
+        screen.addRegionToUpdate(
+                FIELD_OFFSET_X + col * (FIELD_TILE_WIDTH + FIELD_GAP_X),
+                FIELD_OFFSET_Y + row * (FIELD_TILE_HEIGHT + FIELD_GAP_Y),
+                FIELD_TILE_WIDTH, FIELD_TILE_HEIGHT);
 }
 
 
 void Puzzle::drawRow(int row, bool addToUpdate)
 {
+    IconSet::Blit blits[PUZZLE_SIZE * (PUZZLE_SIZE + 1)];
+    int cnt = 0;
     for (int i = 0; i < PUZZLE_SIZE; i++)
-        drawCell(i, row, addToUpdate);
+        cnt += getCellBlits(i, row, blits + cnt);
+    iconSet.drawBatch(blits, cnt);
+
+    if (addToUpdate)
+        screen.addRegionToUpdate(FIELD_OFFSET_X, 
+                FIELD_OFFSET_Y + row * (FIELD_TILE_HEIGHT + FIELD_GAP_Y),
+                PUZZLE_SIZE * (FIELD_TILE_WIDTH + FIELD_GAP_X) - FIELD_GAP_X,
+                FIELD_TILE_HEIGHT);
 }
 
 
@@ -188,6 +213,15 @@ bool Puzzle::onMouseMove(int x, int y)
     return false;
 }
 
+bool Puzzle::getBounds(int &left, int &top, int &width, int &height)
+{
+    left = FIELD_OFFSET_X;
+    top = FIELD_OFFSET_Y;
+    width = (FIELD_TILE_WIDTH + FIELD_GAP_X) * PUZZLE_SIZE;
+    height = (FIELD_TILE_HEIGHT + FIELD_GAP_Y) * PUZZLE_SIZE;
+    return true;
+}
+
 void Puzzle::setCommands(Command *win, Command *fail)
 {
     winCommand = win;
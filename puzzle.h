@@ -18,6 +18,11 @@ class Puzzle: public Widget
         int hCol, hRow;
         int subHNo;
         Command *winCommand, *failCommand;
+
+    private:
+        /// Collect icons of cell to blits array.
+        /// Returns number of icons.
+        int getCellBlits(int col, int row, IconSet::Blit *blits);
         
     public:
         Puzzle(IconSet &is, SolvedPuzzle &solved, Possibilities *possib);
@@ -35,6 +40,7 @@ class Puzzle: public Widget
         void onVictory();
         bool getCellNo(int x, int y, int &col, int &row, int &subNo);
         virtual bool onMouseMove(int x, int y);
+        virtual bool getBounds(int &left, int &top, int &width, int &height);
         void setCommands(Command *winCommand, Command *failCommand);
         void reset();
 };
@@ -1,25 +1,45 @@
 #include "random.h"
 #include "utils.h"
 
-/* Period parameters */  
-#define M 397
-#define MATRIX_A 0x9908b0dfUL   /* constant vector a */
-#define UPPER_MASK 0x80000000UL /* most significant w-r bits */
-#define LOWER_MASK 0x7fffffffUL /* least significant r bits */
+
+static inline unsigned long long rotl(unsigned long long x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+/* splitmix64 step, spreads seed bits over the whole state */
+static inline unsigned long long splitMix(unsigned long long &x)
+{
+    unsigned long long z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* one step of generator on state held in variables */
+#define NEXT(s0, s1, s2, s3, result)        \
+    {                                       \
+        result = rotl(s1 * 5, 7) * 9;       \
+        unsigned long long t = s1 << 17;    \
+        s2 ^= s0;                           \
+        s3 ^= s1;                           \
+        s1 ^= s2;                           \
+        s0 ^= s3;                           \
+        s2 ^= t;                            \
+        s3 = rotl(s3, 45);                  \
+    }
 
 
 Random::Random()
 {
-    mti = RAND_N+1; /* mti==RAND_N+1 means mt[RAND_N] is not initialized */
     struct timeval tv;
     gettimeofday(&tv);
-    unsigned long long int s = tv.tv_sec * 1000000 + tv.tv_usec;
+    unsigned long long int s = tv.tv_sec * 1000000ULL + tv.tv_usec;
     initLong(s);
 }
 
 Random::Random(unsigned long int seed)
 {
-    mti = RAND_N+1; /* mti==RAND_N+1 means mt[RAND_N] is not initialized */
     initLong(seed);
 }
 
@@ -29,29 +49,12 @@ Random::Random(unsigned long int seed)
 /* key_length is its length */
 Random::Random(int init_key[], int key_length)
 {
-    mti = RAND_N+1; /* mti==RAND_N+1 means mt[RAND_N] is not initialized */
-    
-    int i, j, k;
-    initLong(19650218UL);
-    i=1; j=0;
-    k = (RAND_N>key_length ? RAND_N : key_length);
-    for (; k; k--) {
-        mt[i] = (mt[i] ^ ((mt[i-1] ^ (mt[i-1] >> 30)) * 1664525UL))
-          + init_key[j] + j; /* non linear */
-        mt[i] &= 0xffffffffUL; /* for WORDSIZE > 32 machines */
-        i++; j++;
-        if (i>=RAND_N) { mt[0] = mt[RAND_N-1]; i=1; }
-        if (j>=key_length) j=0;
-    }
-    for (k=RAND_N-1; k; k--) {
-        mt[i] = (mt[i] ^ ((mt[i-1] ^ (mt[i-1] >> 30)) * 1566083941UL))
-          - i; /* non linear */
-        mt[i] &= 0xffffffffUL; /* for WORDSIZE > 32 machines */
-        i++;
-        if (i>=RAND_N) { mt[0] = mt[RAND_N-1]; i=1; }
+    unsigned long long x = 19650218ULL;
+    for (int i = 0; i < key_length; i++) {
+        x ^= (unsigned int)init_key[i];
+        x = splitMix(x);
     }
-
-    mt[0] = 0x80000000UL; /* MSB is 1; assuring non-zero initial array */ 
+    initLong(x);
 }
 
 
@@ -60,65 +63,39 @@ Random::~Random()
 {
 }
 
-/* initializes mt[RAND_N] with a seed */
-void Random::initLong(unsigned long s)
+/* initializes state with a seed */
+void Random::initLong(unsigned long long seed)
 {
-    mt[0]= s & 0xffffffffUL;
-    for (mti=1; mti<RAND_N; mti++) {
-        mt[mti] = 
-	    (1812433253UL * (mt[mti-1] ^ (mt[mti-1] >> 30)) + mti); 
-        /* See Knuth TAOCP Vol2. 3rd Ed. P.106 for multiplier. */
-        /* In the previous versions, MSBs of the seed affect   */
-        /* only MSBs of the array mt[].                        */
-        /* 2002/01/09 modified by Makoto Matsumoto             */
-        mt[mti] &= 0xffffffffUL;
-        /* for >32 bit machines */
-    }
+    for (int i = 0; i < 4; i++)
+        s[i] = splitMix(seed);
 }
 
 
-/* generates a random number on [0,0xffffffff]-interval */
-unsigned long Random::genInt32(void)
+/* restarts generator from a seed */
+void Random::setSeed(unsigned long long seed)
 {
-    unsigned long y;
-    static unsigned long mag01[2]={0x0UL, MATRIX_A};
-    /* mag01[x] = x * MATRIX_A  for x=0,1 */
-
-    if (mti >= RAND_N) { /* generate N words at one time */
-        int kk;
-
-        if (mti == RAND_N+1)   /* if init_genrand() has not been called, */
-            initLong(5489UL); /* a default initial seed is used */
-
-        for (kk=0;kk<RAND_N-M;kk++) {
-            y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
-            mt[kk] = mt[kk+M] ^ (y >> 1) ^ mag01[y & 0x1UL];
-        }
-        for (;kk<RAND_N-1;kk++) {
-            y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
-            mt[kk] = mt[kk+(M-RAND_N)] ^ (y >> 1) ^ mag01[y & 0x1UL];
-        }
-        y = (mt[RAND_N-1]&UPPER_MASK)|(mt[0]&LOWER_MASK);
-        mt[RAND_N-1] = mt[M-1] ^ (y >> 1) ^ mag01[y & 0x1UL];
+    initLong(seed);
+}
 
-        mti = 0;
-    }
-  
-    y = mt[mti++];
 
-    /* Tempering */
-    y ^= (y >> 11);
-    y ^= (y << 7) & 0x9d2c5680UL;
-    y ^= (y << 15) & 0xefc60000UL;
-    y ^= (y >> 18);
+/* generates a random number on [0,0xffffffffffffffff]-interval */
+unsigned long long Random::genInt64()
+{
+    unsigned long long result;
+    NEXT(s[0], s[1], s[2], s[3], result);
+    return result;
+}
 
-    return y;
+/* generates a random number on [0,0xffffffff]-interval */
+unsigned long Random::genInt32(void)
+{
+    return (unsigned long)(genInt64() >> 32);
 }
 
 /* generates a random number on [0,0x7fffffff]-interval */
 long Random::genInt31()
 {
-    return (long)(genInt32()>>1);
+    return (long)(genInt64() >> 33);
 }
 
 /* generates a random number on [0,1]-real-interval */
@@ -145,15 +122,63 @@ double Random::genReal3(void)
 /* generates a random number on [0,1) with 53-bit resolution*/
 double Random::genReal53(void)
 {
-    unsigned long a=genInt32()>>5, b=genInt32()>>6; 
-    return(a*67108864.0+b)*(1.0/9007199254740992.0); 
+    return (genInt64() >> 11) * (1.0/9007199254740992.0); 
+    /* divided by 2^53 */
 }
 
 /* generate integer random number on [0, range) int interval */
+/* multiply-shift with rejection of the short low part, unbiased */
 int Random::genInt(int range)
 {
-    int v = (int)(genReal2() * range);
-if (v == range) printf("ooops!\n");
-    return v;
+    if (range <= 1)
+        return 0;
+    
+    unsigned int r = range;
+    unsigned long long m = (genInt64() >> 32) * r;
+    if ((unsigned int)m < r) {
+        unsigned int threshold = (0U - r) % r;
+        while ((unsigned int)m < threshold)
+            m = (genInt64() >> 32) * r;
+    }
+    return (int)(m >> 32);
+}
+
+/* fills buffer with count random numbers on [0,0xffffffff] */
+/* state is kept in locals so two numbers come from every step */
+void Random::fill(unsigned int *buf, int count)
+{
+    unsigned long long s0 = s[0], s1 = s[1], s2 = s[2], s3 = s[3];
+    unsigned long long v;
+    
+    int i;
+    for (i = 0; i + 1 < count; i += 2) {
+        NEXT(s0, s1, s2, s3, v);
+        buf[i] = (unsigned int)(v >> 32);
+        buf[i + 1] = (unsigned int)v;
+    }
+    if (i < count) {
+        NEXT(s0, s1, s2, s3, v);
+        buf[i] = (unsigned int)(v >> 32);
+    }
+    
+    s[0] = s0; s[1] = s1; s[2] = s2; s[3] = s3;
+}
+
+/* advances state by 2^128 numbers */
+void Random::jump()
+{
+    static const unsigned long long JUMP[] = { 0x180ec6d33cfd0abaULL, 
+        0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+
+    unsigned long long t[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < 4; i++)
+        for (int b = 0; b < 64; b++) {
+            if (JUMP[i] & (1ULL << b))
+                for (int j = 0; j < 4; j++)
+                    t[j] ^= s[j];
+            genInt64();
+        }
+    for (int j = 0; j < 4; j++)
+        s[j] = t[j];
 }
 
@@ -3,12 +3,11 @@
 
 
 
+/* xoshiro256** generator by David Blackman and Sebastiano Vigna */
 class Random
 {
     private:
-#define RAND_N 624
-        unsigned long mt[RAND_N]; /* the array for the state vector  */
-        int mti; /* mti==RAND_N+1 means mt[RAND_N] is not initialized */
+        unsigned long long s[4]; /* the state, never all zeroes */
     
     public:
         Random();
@@ -17,6 +16,8 @@ class Random
         ~Random();
 
     public:
+        /* generates a random number on [0,0xffffffffffffffff]-interval */
+        unsigned long long genInt64();
         /* generates a random number on [0,0xffffffff]-interval */
         unsigned long int genInt32();
         /* generates a random number on [0,0x7fffffff]-interval */
@@ -31,9 +32,16 @@ class Random
         double genReal53(); 
         /* generate integer random number on [0, range) int interval */
         int genInt(int range);
+        /* fills buffer with count random numbers on [0,0xffffffff] */
+        void fill(unsigned int *buf, int count);
+        /* advances state by 2^128 numbers, used to give independent
+           streams to parallel workers */
+        void jump();
+        /* restarts generator from a seed */
+        void setSeed(unsigned long long seed);
 
     private:
-        void initLong(unsigned long int s);
+        void initLong(unsigned long long seed);
 };
 
 
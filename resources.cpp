@@ -1,5 +1,7 @@
 #include <algorithm>
+#include <stdio.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <dirent.h>
 #include <zlib.h>
 
@@ -11,6 +13,10 @@
 #include "utils.h"
 
 
+#define CACHE_MAGIC     0x43435245
+#define CACHE_VERSION   1
+
+
 ResourcesCollection *resources = NULL;
 
 
@@ -425,26 +431,6 @@ Resource::~Resource()
         delete *i;
 }
 
-class ScorePredicate
-{
-    public:
-        int score;
-        
-        ScorePredicate(int sc) { score = sc; }
-
-        bool operator() (const ResVariant *r) const {
-            return r->getI18nScore() == score;
-        };
-};
-
-class ResVariantMoreThen
-{
-    public:
-        bool operator() (const ResVariant *v1, const ResVariant *v2) const {
-            return v1->getI18nScore() > v2->getI18nScore();
-        };
-};
-
 void Resource::addVariant(ResourceFile *file, int i18nScore,
         const ResourceFile::DirectoryEntry &entry)
 {
@@ -453,16 +439,16 @@ void Resource::addVariant(ResourceFile *file, int i18nScore,
         return;
     }
     
-    ScorePredicate p(i18nScore);
-    Variants::iterator i = std::find_if(variants.begin(), variants.end(), p);
-    if (i != variants.end()) {
+    // variants are kept sorted by score, so new one is inserted
+    // before first variant with lower score
+    Variants::iterator i = variants.begin();
+    while ((i != variants.end()) && ((*i)->getI18nScore() > i18nScore))
+        i++;
+    if ((i != variants.end()) && ((*i)->getI18nScore() == i18nScore)) {
         delete *i;
         *i = new ResVariant(file, i18nScore, entry);
-    } else {
-        variants.push_back(new ResVariant(file, i18nScore, entry));
-        ResVariantMoreThen comparator;
-        std::sort(variants.begin(), variants.end(), comparator);
-    }
+    } else
+        variants.insert(i, new ResVariant(file, i18nScore, entry));
 }
 
 
@@ -553,38 +539,192 @@ void ResourcesCollection::loadResourceFiles(StringList &directories)
 }
 
 
+static bool getFileStamp(const std::wstring &fileName, long &size, 
+        long &time)
+{
+    struct stat buf;
+    if (stat(toMbcs(fileName).c_str(), &buf))
+        return false;
+    size = buf.st_size;
+    time = buf.st_mtime;
+    return true;
+}
+
+
 void ResourcesCollection::processFiles()
 {
-    ResourceFile::Directory dir;
+    LocaleCache cache, newCache;
+    loadCache(cache);
+    bool changed = false;
+    
     for (std::vector<ResourceFile*>::iterator i = files.begin(); 
             i != files.end(); i++) 
     {
         ResourceFile *file = *i;
-        file->getDirectory(dir);
-        for (ResourceFile::Directory::iterator j = dir.begin(); 
-                j != dir.end(); j++) 
+        const std::wstring &fileName = file->getFileName();
+        FileCache &fc = newCache[fileName];
+        if (! getFileStamp(fileName, fc.size, fc.time)) {
+            fc.size = -1;
+            fc.time = -1;
+        }
+        
+        LocaleCache::iterator c = cache.find(fileName);
+        if ((c != cache.end()) && (fc.size >= 0) &&
+                ((*c).second.size == fc.size) && 
+                ((*c).second.time == fc.time))
+            fc.entries.swap((*c).second.entries);
+        else {
+            localizeDirectory(file, fc.entries);
+            changed = true;
+        }
+        
+        for (LocalizedEntries::iterator j = fc.entries.begin(); 
+                j != fc.entries.end(); j++) 
         {
-            ResourceFile::DirectoryEntry &de = *j;
-            std::wstring name, ext, language, country;
-            splitFileName(de.name, name, ext, language, country);
-            int score = getScore(language, country, locale);
-            if (score > 0) {
-                std::wstring resName = name + L"." + ext;
-                Resource *res = resources[resName];
-                if (! res) {
-                    res = new Resource(file, score, de, resName);
-                    resources[resName] = res;
-                    if (de.group.length())
-                        groups[de.group].push_back(res);
-                } else
-                    res->addVariant(file, score, de);
+            LocalizedEntry &le = *j;
+            Resource *res = resources[le.name];
+            if (! res) {
+                res = new Resource(file, le.score, le.entry, le.name);
+                resources[le.name] = res;
+                if (le.entry.group.length())
+                    groups[le.entry.group].push_back(res);
+            } else
+                res->addVariant(file, le.score, le.entry);
+        }
+    }
+
+    if (changed || (cache.size() != newCache.size()))
+        saveCache(newCache);
+}
+
+
+void ResourcesCollection::localizeDirectory(ResourceFile *file, 
+        LocalizedEntries &entries)
+{
+    // most of entries share few locales, so score is calculated once
+    // for each language and country pair
+    std::map<std::wstring, int> scores;
+    
+    ResourceFile::Directory dir;
+    file->getDirectory(dir);
+    for (ResourceFile::Directory::iterator j = dir.begin(); 
+            j != dir.end(); j++) 
+    {
+        ResourceFile::DirectoryEntry &de = *j;
+        std::wstring name, ext, language, country;
+        splitFileName(de.name, name, ext, language, country);
+        std::wstring key(language + L"_" + country);
+        std::map<std::wstring, int>::iterator s = scores.find(key);
+        int score;
+        if (s == scores.end()) {
+            score = getScore(language, country, locale);
+            scores[key] = score;
+        } else
+            score = (*s).second;
+        if (score > 0) {
+            LocalizedEntry le;
+            le.name = name + L"." + ext;
+            le.score = score;
+            le.entry = de;
+            entries.push_back(le);
+        }
+    }
+}
+
+
+std::wstring ResourcesCollection::getCacheFileName()
+{
+#ifndef WIN32
+    return std::wstring(fromMbcs(getenv("HOME"))) + 
+        L"/.einstein/resources.cache";
+#else
+    return L"resources.cache";
+#endif
+}
+
+
+void ResourcesCollection::loadCache(LocaleCache &cache)
+{
+    std::ifstream stream(toMbcs(getCacheFileName()).c_str(), 
+            std::ios::in | std::ios::binary);
+    if (stream.fail())
+        return;
+    
+    try {
+        if ((readInt(stream) != CACHE_MAGIC) || 
+                (readInt(stream) != CACHE_VERSION) ||
+                (readString(stream) != locale.getLanguage()) ||
+                (readString(stream) != locale.getCountry()))
+            return;
+        
+        int filesCnt = readInt(stream);
+        for (int i = 0; i < filesCnt; i++) {
+            FileCache &fc = cache[readString(stream)];
+            fc.size = readInt(stream);
+            fc.time = readInt(stream);
+            int cnt = readInt(stream);
+            for (int j = 0; j < cnt; j++) {
+                fc.entries.push_back(LocalizedEntry());
+                LocalizedEntry &le = fc.entries.back();
+                le.name = readString(stream);
+                le.score = readInt(stream);
+                le.entry.name = readString(stream);
+                le.entry.offset = readInt(stream);
+                le.entry.packedSize = readInt(stream);
+                le.entry.unpackedSize = readInt(stream);
+                le.entry.level = readInt(stream);
+                le.entry.group = readString(stream);
             }
         }
-        dir.clear();
+    } catch (Exception &e) {
+        // broken cache, directories will be read from resource files
+        cache.clear();
     }
 }
 
 
+void ResourcesCollection::saveCache(const LocaleCache &cache)
+{
+    std::string name(toMbcs(getCacheFileName()));
+    std::string tmpName(name + ".tmp");
+    std::ofstream stream(tmpName.c_str(), std::ios::out | std::ios::binary);
+    if (stream.fail())
+        return;
+    
+    writeInt(stream, CACHE_MAGIC);
+    writeInt(stream, CACHE_VERSION);
+    writeString(stream, locale.getLanguage());
+    writeString(stream, locale.getCountry());
+    writeInt(stream, cache.size());
+    for (LocaleCache::const_iterator i = cache.begin(); i != cache.end(); i++)
+    {
+        const FileCache &fc = (*i).second;
+        writeString(stream, (*i).first);
+        writeInt(stream, fc.size);
+        writeInt(stream, fc.time);
+        writeInt(stream, fc.entries.size());
+        for (LocalizedEntries::const_iterator j = fc.entries.begin();
+                j != fc.entries.end(); j++)
+        {
+            const LocalizedEntry &le = *j;
+            writeString(stream, le.name);
+            writeInt(stream, le.score);
+            writeString(stream, le.entry.name);
+            writeInt(stream, le.entry.offset);
+            writeInt(stream, le.entry.packedSize);
+            writeInt(stream, le.entry.unpackedSize);
+            writeInt(stream, le.entry.level);
+            writeString(stream, le.entry.group);
+        }
+    }
+    
+    bool ok = stream.good();
+    stream.close();
+    if ((! ok) || (! replaceFile(tmpName, name)))
+        remove(tmpName.c_str());
+}
+
+
 Resource* ResourcesCollection::getResource(const std::wstring &name)
 {
     Resource *r = resources[name];
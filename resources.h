@@ -324,6 +324,26 @@ class ResourcesCollection
         /// List of resource files.
         typedef std::vector<ResourceFile*> ResourceFiles;
         
+        /// Resource file entry resolved for current locale.
+        typedef struct {
+            std::wstring name;          /// resource name without locale
+            int score;                  /// locale compability score
+            ResourceFile::DirectoryEntry entry;  /// resource file entry
+        } LocalizedEntry;
+        
+        /// List of resource file entries usable in current locale.
+        typedef std::vector<LocalizedEntry> LocalizedEntries;
+        
+        /// Resolved entries of single resource file.
+        typedef struct {
+            long size;                  /// size of resource file
+            long time;                  /// modification time of file
+            LocalizedEntries entries;   /// entries usable in current locale
+        } FileCache;
+        
+        /// Map resource file names to their resolved entries.
+        typedef std::map<std::wstring, FileCache> LocaleCache;
+        
         ResourcesMap resources;    /// Map of all available resources.
         ResourcesListMap groups;   /// Map of all available groups.
         ResourceFiles files;       /// List of resource files.
@@ -373,6 +393,22 @@ class ResourcesCollection
 
         /// Make grouping and locale processing.
         void processFiles();
+
+        /// Read resource file directory and resolve locale of its entries.
+        /// \param file resource file
+        /// \param entries list where usable entries will be placed
+        void localizeDirectory(ResourceFile *file, LocalizedEntries &entries);
+
+        /// Get name of file with resolved entries.
+        std::wstring getCacheFileName();
+
+        /// Load resolved entries saved for current locale.
+        /// \param cache map where entries will be placed
+        void loadCache(LocaleCache &cache);
+
+        /// Save resolved entries for current locale.
+        /// \param cache resolved entries of all resource files
+        void saveCache(const LocaleCache &cache);
 };
 
 
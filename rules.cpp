@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "puzgen.h"
 #include "utils.h"
 #include "main.h"
@@ -13,6 +14,57 @@ static std::wstring getThingName(int row, int thing)
     return s;
 }
 
+static int getThing(int row, int thing)
+{
+    return row * PUZZLE_SIZE + thing - 1;
+}
+
+
+/// Rules propagate over sets of columns, one bit per column.  Masks are
+/// read again after every exclusion so results match column by column
+/// scan with checkSingles() running between exclusions.
+
+#define ALL_COLS    ((1 << PUZZLE_SIZE) - 1)
+
+/// Columns to the right of given columns.
+static inline int toRight(int cols)
+{
+    return (cols << 1) & ALL_COLS;
+}
+
+/// Columns to the left of given columns.
+static inline int toLeft(int cols)
+{
+    return cols >> 1;
+}
+
+/// Columns starting from col.
+static inline int fromCol(int col)
+{
+    return ALL_COLS & ~((1 << col) - 1);
+}
+
+/// Columns up to col inclusive.
+static inline int upToCol(int col)
+{
+    return (2 << col) - 1;
+}
+
+static inline int getFirstCol(int cols)
+{
+    int col = 0;
+    while (! (cols & (1 << col)))
+        col++;
+    return col;
+}
+
+static inline int getLastCol(int cols)
+{
+    int col = PUZZLE_SIZE - 1;
+    while (! (cols & (1 << col)))
+        col--;
+    return col;
+}
 
 
 class NearRule: public Rule
@@ -28,11 +80,10 @@ class NearRule: public Rule
         virtual std::wstring getAsText();
 
     private:
-        bool applyToCol(Possibilities &pos, int col, int nearRow, int nearNum,
-            int thisRow, int thisNum);
         virtual void draw(int x, int y, IconSet &iconSet, bool highlighted);
         virtual ShowOptions getShowOpts() { return SHOW_HORIZ; };
         virtual void save(std::ostream &stream);
+        virtual Info getInfo();
 };
 
 
@@ -68,41 +119,41 @@ NearRule::NearRule(std::istream &stream)
 }
 
 
-bool NearRule::applyToCol(Possibilities &pos, int col, int nearRow, int nearNum,
-        int thisRow, int thisNum)
+/// Columns of thing without neighbour columns of other thing.
+static inline int getLonely(int cols, int otherCols)
 {
-    bool hasLeft, hasRight;
-    
-    if (col == 0)
-        hasLeft = false;
-    else
-        hasLeft = pos.isPossible(col - 1, nearRow, nearNum);
-    if (col == PUZZLE_SIZE-1)
-        hasRight = false;
-    else
-        hasRight = pos.isPossible(col + 1, nearRow, nearNum);
-    
-    if ((! hasRight) && (! hasLeft) && pos.isPossible(col, thisRow, thisNum)) {
-        pos.exclude(col, thisRow, thisNum);
-        return true;
-    } else
-        return false;
+    return cols & ~(toLeft(otherCols) | toRight(otherCols));
 }
 
-
 bool NearRule::apply(Possibilities &pos)
 {
     bool changed = false;
+    bool passChanged;
     
-    for (int i = 0; i < PUZZLE_SIZE; i++) {
-        if (applyToCol(pos, i, thing1[0], thing1[1], thing2[0], thing2[1]))
-            changed = true;
-        if (applyToCol(pos, i, thing2[0], thing2[1], thing1[0], thing1[1]))
+    do {
+        passChanged = false;
+        int col = 0;
+        for (;;) {
+            int cols1 = pos.getColumns(thing1[0], thing1[1]);
+            int cols2 = pos.getColumns(thing2[0], thing2[1]);
+            int lonely = (getLonely(cols1, cols2) | getLonely(cols2, cols1)) &
+                fromCol(col);
+            if (! lonely)
+                break;
+            col = getFirstCol(lonely);
+            if (getLonely(cols2, cols1) & (1 << col)) {
+                pos.exclude(col, thing2[0], thing2[1]);
+                cols2 = pos.getColumns(thing2[0], thing2[1]);
+                cols1 = pos.getColumns(thing1[0], thing1[1]);
+            }
+            if (getLonely(cols1, cols2) & (1 << col))
+                pos.exclude(col, thing1[0], thing1[1]);
+            passChanged = true;
+            col++;
+        }
+        if (passChanged)
             changed = true;
-    }
-
-    if (changed)
-        apply(pos);
+    } while (passChanged);
 
     return changed;
 }
@@ -115,10 +166,10 @@ std::wstring NearRule::getAsText()
 
 void NearRule::draw(int x, int y, IconSet &iconSet, bool h)
 {
-    SDL_Surface *icon = iconSet.getLargeIcon(thing1[0], thing1[1], h);
-    screen.draw(x, y, icon);
-    screen.draw(x + icon->h, y, iconSet.getNearHintIcon(h));
-    screen.draw(x + icon->h*2, y, iconSet.getLargeIcon(thing2[0], thing2[1], h));
+    const SDL_Rect &icon = iconSet.getLargeIcon(thing1[0], thing1[1], h);
+    iconSet.draw(x, y, icon);
+    iconSet.draw(x + icon.h, y, iconSet.getNearHintIcon(h));
+    iconSet.draw(x + icon.h*2, y, iconSet.getLargeIcon(thing2[0], thing2[1], h));
 }
 
 void NearRule::save(std::ostream &stream)
@@ -130,6 +181,16 @@ void NearRule::save(std::ostream &stream)
     writeInt(stream, thing2[1]);
 }
 
+Rule::Info NearRule::getInfo()
+{
+    Info info;
+    info.kind = NEAR_RULE;
+    info.thing1 = getThing(thing1[0], thing1[1]);
+    info.thing2 = getThing(thing2[0], thing2[1]);
+    info.center = info.col = -1;
+    return info;
+}
+
 
 class DirectionRule: public Rule
 {
@@ -147,6 +208,7 @@ class DirectionRule: public Rule
         virtual void draw(int x, int y, IconSet &iconSet, bool highlighted);
         virtual ShowOptions getShowOpts() { return SHOW_HORIZ; };
         virtual void save(std::ostream &stream);
+        virtual Info getInfo();
 };
 
 
@@ -172,22 +234,36 @@ bool DirectionRule::apply(Possibilities &pos)
 {
     bool changed = false;
 
-    for (int i = 0; i < PUZZLE_SIZE; i++) {
-        if (pos.isPossible(i, row2, thing2)) {
-            pos.exclude(i, row2, thing2);
-            changed = true;
-        }
-        if (pos.isPossible(i, row1, thing1))
+    // thing2 is not at or before leftmost column of thing1
+    int col = 0;
+    while (col < PUZZLE_SIZE) {
+        int cols1 = pos.getColumns(row1, thing1) & fromCol(col);
+        int cols2 = pos.getColumns(row2, thing2) & fromCol(col);
+        int first = cols1 ? upToCol(getFirstCol(cols1)) : ALL_COLS;
+        if (! (cols2 & first))
+            break;
+        col = getFirstCol(cols2 & first);
+        pos.exclude(col, row2, thing2);
+        changed = true;
+        if (pos.isPossible(col, row1, thing1))
             break;
+        col++;
     }
     
-    for (int i = PUZZLE_SIZE-1; i >= 0; i--) {
-        if (pos.isPossible(i, row1, thing1)) {
-            pos.exclude(i, row1, thing1);
-            changed = true;
-        }
-        if (pos.isPossible(i, row2, thing2))
+    // thing1 is not at or after rightmost column of thing2
+    col = PUZZLE_SIZE - 1;
+    while (col >= 0) {
+        int cols1 = pos.getColumns(row1, thing1) & upToCol(col);
+        int cols2 = pos.getColumns(row2, thing2) & upToCol(col);
+        int last = cols2 ? fromCol(getLastCol(cols2)) : ALL_COLS;
+        if (! (cols1 & last))
             break;
+        col = getLastCol(cols1 & last);
+        pos.exclude(col, row1, thing1);
+        changed = true;
+        if (pos.isPossible(col, row2, thing2))
+            break;
+        col--;
     }
     
     return changed;
@@ -201,10 +277,10 @@ std::wstring DirectionRule::getAsText()
 
 void DirectionRule::draw(int x, int y, IconSet &iconSet, bool h)
 {
-    SDL_Surface *icon = iconSet.getLargeIcon(row1, thing1, h);
-    screen.draw(x, y, icon);
-    screen.draw(x + icon->h, y, iconSet.getSideHintIcon(h));
-    screen.draw(x + icon->h*2, y, iconSet.getLargeIcon(row2, thing2, h));
+    const SDL_Rect &icon = iconSet.getLargeIcon(row1, thing1, h);
+    iconSet.draw(x, y, icon);
+    iconSet.draw(x + icon.h, y, iconSet.getSideHintIcon(h));
+    iconSet.draw(x + icon.h*2, y, iconSet.getLargeIcon(row2, thing2, h));
 }
 
 void DirectionRule::save(std::ostream &stream)
@@ -216,6 +292,16 @@ void DirectionRule::save(std::ostream &stream)
     writeInt(stream, thing2);
 }
 
+Rule::Info DirectionRule::getInfo()
+{
+    Info info;
+    info.kind = DIRECTION_RULE;
+    info.thing1 = getThing(row1, thing1);
+    info.thing2 = getThing(row2, thing2);
+    info.center = info.col = -1;
+    return info;
+}
+
 
 class OpenRule: public Rule
 {
@@ -231,6 +317,7 @@ class OpenRule: public Rule
         virtual void draw(int x, int y, IconSet &iconSet, bool highlighted) { };
         virtual ShowOptions getShowOpts() { return SHOW_NOTHING; };
         virtual void save(std::ostream &stream);
+        virtual Info getInfo();
 };
 
 
@@ -270,6 +357,16 @@ void OpenRule::save(std::ostream &stream)
     writeInt(stream, thing);
 }
 
+Rule::Info OpenRule::getInfo()
+{
+    Info info;
+    info.kind = OPEN_RULE;
+    info.thing1 = getThing(row, thing);
+    info.thing2 = info.center = -1;
+    info.col = col;
+    return info;
+}
+
 
 class UnderRule: public Rule
 {
@@ -284,6 +381,7 @@ class UnderRule: public Rule
         virtual void draw(int x, int y, IconSet &iconSet, bool highlighted);
         virtual ShowOptions getShowOpts() { return SHOW_VERT; };
         virtual void save(std::ostream &stream);
+        virtual Info getInfo();
 };
 
 
@@ -310,19 +408,22 @@ bool UnderRule::apply(Possibilities &pos)
 {
     bool changed = false;
  
-    for (int i = 0; i < PUZZLE_SIZE; i++) {
-        if ((! pos.isPossible(i, row1, thing1)) && 
-                pos.isPossible(i, row2, thing2)) 
-        {
-            pos.exclude(i, row2, thing2);
-            changed = true;
-        }
-        if ((! pos.isPossible(i, row2, thing2)) && 
-                pos.isPossible(i, row1, thing1)) 
-        {
-            pos.exclude(i, row1, thing1);
-            changed = true;
-        }
+    // columns where only one of things is possible
+    int col = 0;
+    for (;;) {
+        int cols1 = pos.getColumns(row1, thing1);
+        int cols2 = pos.getColumns(row2, thing2);
+        int single = (cols1 ^ cols2) & fromCol(col);
+        if (! single)
+            break;
+        col = getFirstCol(single);
+        if (cols2 & (1 << col))
+            pos.exclude(col, row2, thing2);
+        if ((! pos.isPossible(col, row2, thing2)) && 
+                pos.isPossible(col, row1, thing1))
+            pos.exclude(col, row1, thing1);
+        changed = true;
+        col++;
     }
 
     return changed;
@@ -337,9 +438,9 @@ std::wstring UnderRule::getAsText()
 
 void UnderRule::draw(int x, int y, IconSet &iconSet, bool h)
 {
-    SDL_Surface *icon = iconSet.getLargeIcon(row1, thing1, h);
-    screen.draw(x, y, icon);
-    screen.draw(x, y + icon->h, iconSet.getLargeIcon(row2, thing2, h));
+    const SDL_Rect &icon = iconSet.getLargeIcon(row1, thing1, h);
+    iconSet.draw(x, y, icon);
+    iconSet.draw(x, y + icon.h, iconSet.getLargeIcon(row2, thing2, h));
 }
 
 void UnderRule::save(std::ostream &stream)
@@ -351,6 +452,16 @@ void UnderRule::save(std::ostream &stream)
     writeInt(stream, thing2);
 }
 
+Rule::Info UnderRule::getInfo()
+{
+    Info info;
+    info.kind = UNDER_RULE;
+    info.thing1 = getThing(row1, thing1);
+    info.thing2 = getThing(row2, thing2);
+    info.center = info.col = -1;
+    return info;
+}
+
 
 
 class BetweenRule: public Rule
@@ -370,6 +481,7 @@ class BetweenRule: public Rule
         virtual void draw(int x, int y, IconSet &iconSet, bool highlighted);
         virtual ShowOptions getShowOpts() { return SHOW_HORIZ; };
         virtual void save(std::ostream &stream);
+        virtual Info getInfo();
 };
 
 
@@ -418,55 +530,49 @@ bool BetweenRule::apply(Possibilities &pos)
     do {
         goodLoop = false;
         
-        for (int i = 1; i < PUZZLE_SIZE-1; i++) {
-            if (pos.isPossible(i, centerRow, centerThing)) {
-                if (! ((pos.isPossible(i-1, row1, thing1) && 
-                            pos.isPossible(i+1, row2, thing2)) ||
-                        (pos.isPossible(i-1, row2, thing2) && 
-                            pos.isPossible(i+1, row1, thing1))))
-                {
-                    pos.exclude(i, centerRow, centerThing);
-                    goodLoop = true;
-                }
-            }
+        // center needs thing1 and thing2 at both sides
+        int col = 1;
+        for (;;) {
+            int cols1 = pos.getColumns(row1, thing1);
+            int cols2 = pos.getColumns(row2, thing2);
+            int between = (toRight(cols1) & toLeft(cols2)) |
+                (toRight(cols2) & toLeft(cols1));
+            int bad = pos.getColumns(centerRow, centerThing) & ~between &
+                fromCol(col) & upToCol(PUZZLE_SIZE - 2);
+            if (! bad)
+                break;
+            col = getFirstCol(bad);
+            pos.exclude(col, centerRow, centerThing);
+            goodLoop = true;
+            col++;
         }
 
-        for (int i = 0; i < PUZZLE_SIZE; i++) {
-            bool leftPossible, rightPossible;
-
-            if (pos.isPossible(i, row2, thing2)) {
-                if (i < 2)
-                    leftPossible = false;
-                else
-                    leftPossible = (pos.isPossible(i-1, centerRow, centerThing)
-                            && pos.isPossible(i-2, row1, thing1));
-                if (i >= PUZZLE_SIZE - 2)
-                    rightPossible = false;
-                else
-                    rightPossible = (pos.isPossible(i+1, centerRow, centerThing)
-                            && pos.isPossible(i+2, row1, thing1));
-                if ((! leftPossible) && (! rightPossible)) {
-                    pos.exclude(i, row2, thing2);
-                    goodLoop = true;
-                }
-            }
-
-            if (pos.isPossible(i, row1, thing1)) {
-                if (i < 2)
-                    leftPossible = false;
-                else
-                    leftPossible = (pos.isPossible(i-1, centerRow, centerThing)
-                            && pos.isPossible(i-2, row2, thing2));
-                if (i >= PUZZLE_SIZE - 2)
-                    rightPossible = false;
-                else
-                    rightPossible = (pos.isPossible(i+1, centerRow, centerThing)
-                            && pos.isPossible(i+2, row2, thing2));
-                if ((! leftPossible) && (! rightPossible)) {
-                    pos.exclude(i, row1, thing1);
-                    goodLoop = true;
-                }
+        // thing1 and thing2 need center and other thing at one side
+        col = 0;
+        for (;;) {
+            int cols1 = pos.getColumns(row1, thing1);
+            int cols2 = pos.getColumns(row2, thing2);
+            int center = pos.getColumns(centerRow, centerThing);
+            int bad1 = cols1 & ~((toRight(center) & toRight(toRight(cols2))) |
+                (toLeft(center) & toLeft(toLeft(cols2))));
+            int bad2 = cols2 & ~((toRight(center) & toRight(toRight(cols1))) |
+                (toLeft(center) & toLeft(toLeft(cols1))));
+            int bad = (bad1 | bad2) & fromCol(col);
+            if (! bad)
+                break;
+            col = getFirstCol(bad);
+            if (bad2 & (1 << col)) {
+                pos.exclude(col, row2, thing2);
+                cols2 = pos.getColumns(row2, thing2);
+                center = pos.getColumns(centerRow, centerThing);
+                bad1 = pos.getColumns(row1, thing1) & 
+                    ~((toRight(center) & toRight(toRight(cols2))) |
+                    (toLeft(center) & toLeft(toLeft(cols2))));
             }
+            if (bad1 & (1 << col))
+                pos.exclude(col, row1, thing1);
+            goodLoop = true;
+            col++;
         }
 
         if (goodLoop)
@@ -485,12 +591,12 @@ std::wstring BetweenRule::getAsText()
 
 void BetweenRule::draw(int x, int y, IconSet &iconSet, bool h)
 {
-    SDL_Surface *icon = iconSet.getLargeIcon(row1, thing1, h);
-    screen.draw(x, y, icon);
-    screen.draw(x + icon->w, y, iconSet.getLargeIcon(centerRow, centerThing, h));
-    screen.draw(x + icon->w*2, y, iconSet.getLargeIcon(row2, thing2, h));
+    const SDL_Rect &icon = iconSet.getLargeIcon(row1, thing1, h);
+    iconSet.draw(x, y, icon);
+    iconSet.draw(x + icon.w, y, iconSet.getLargeIcon(centerRow, centerThing, h));
+    iconSet.draw(x + icon.w*2, y, iconSet.getLargeIcon(row2, thing2, h));
     SDL_Surface *arrow = iconSet.getBetweenArrow(h);
-    screen.draw(x + icon->w - (arrow->w - icon->w) / 2, y + 0, arrow);
+    screen.draw(x + icon.w - (arrow->w - icon.w) / 2, y + 0, arrow);
 }
 
 void BetweenRule::save(std::ostream &stream)
@@ -504,28 +610,82 @@ void BetweenRule::save(std::ostream &stream)
     writeInt(stream, centerThing);
 }
 
+Rule::Info BetweenRule::getInfo()
+{
+    Info info;
+    info.kind = BETWEEN_RULE;
+    info.thing1 = getThing(row1, thing1);
+    info.thing2 = getThing(row2, thing2);
+    info.center = getThing(centerRow, centerThing);
+    info.col = -1;
+    return info;
+}
 
 
-Rule* genRule(SolvedPuzzle &puzzle)
+
+unsigned int Rule::getRuleKey(const Info &info)
+{
+    int a = info.thing1;
+    int b = info.thing2;
+    int c = 0;
+
+    switch (info.kind) {
+        case NEAR_RULE:
+        case UNDER_RULE:
+            if (a > b)
+                std::swap(a, b);
+            break;
+        case DIRECTION_RULE:
+            break;
+        case OPEN_RULE:
+            b = info.col;
+            break;
+        case BETWEEN_RULE:
+            if (a > b)
+                std::swap(a, b);
+            c = info.center;
+            break;
+    }
+    
+    return (info.kind << 18) | (a << 12) | (b << 6) | c;
+}
+
+
+Rule* genRule(SolvedPuzzle &puzzle, Rule::Kind kind)
 {
-    int a = rndGen.genInt(14);
-    switch (a) {
-        case 0:
-        case 1:
-        case 2:
-        case 3: return new NearRule(puzzle);
-        case 4: return new OpenRule(puzzle);
-        case 5:
-        case 6: return new UnderRule(puzzle);
-        case 7:
-        case 8:
-        case 9:
-        case 10: return new DirectionRule(puzzle);
-        case 11:
-        case 12:
-        case 13: return new BetweenRule(puzzle);
-        default: return genRule(puzzle);
+    switch (kind) {
+        case Rule::NEAR_RULE: return new NearRule(puzzle);
+        case Rule::DIRECTION_RULE: return new DirectionRule(puzzle);
+        case Rule::OPEN_RULE: return new OpenRule(puzzle);
+        case Rule::UNDER_RULE: return new UnderRule(puzzle);
+        case Rule::BETWEEN_RULE: return new BetweenRule(puzzle);
     }
+    return NULL;
+}
+
+
+Rule* genRule(SolvedPuzzle &puzzle, const int weights[RULE_KINDS_CNT])
+{
+    int total = 0;
+    for (int i = 0; i < RULE_KINDS_CNT; i++)
+        total += weights[i];
+    if (total <= 0)
+        throw Exception(L"No rule kinds allowed");
+
+    int a = rndGen.genInt(total);
+    for (int i = 0; i < RULE_KINDS_CNT; i++) {
+        if (a < weights[i])
+            return genRule(puzzle, (Rule::Kind)i);
+        a -= weights[i];
+    }
+    return NULL;
+}
+
+
+Rule* genRule(SolvedPuzzle &puzzle)
+{
+    static const int weights[RULE_KINDS_CNT] = { 4, 4, 1, 2, 3 };
+    return genRule(puzzle, weights);
 }
 
 
@@ -25,7 +25,8 @@ Screen::~Screen()
 
 const VideoMode Screen::getVideoMode() const
 {
-    return VideoMode(screen->w, screen->h, screen->format->BitsPerPixel, fullScreen);
+    return VideoMode(screen->w, screen->h, screen->format->BitsPerPixel, 
+            fullScreen, (screen->flags & SDL_HWSURFACE) != 0);
 }
 
 
@@ -33,10 +34,18 @@ void Screen::setMode(const VideoMode& mode)
 {
     fullScreen = mode.isFullScreen();
 
-    int flags = SDL_SWSURFACE /*| SDL_OPENGL*/;
+    int flags = SDL_SWSURFACE;
+    if (mode.isAccelerated())
+        flags = SDL_HWSURFACE;
     if (fullScreen)
         flags = flags | SDL_FULLSCREEN;
     screen = SDL_SetVideoMode(mode.getWidth(), mode.getHeight(), mode.getBpp(), flags);
+    if ((! screen) && mode.isAccelerated()) {
+        // no video memory for hardware surface, fall back to software
+        flags = flags & ~SDL_HWSURFACE;
+        screen = SDL_SetVideoMode(mode.getWidth(), mode.getHeight(), 
+                mode.getBpp(), flags);
+    }
     if (! screen)
         throw Exception(L"Couldn't set video mode: " + 
                 fromMbcs((SDL_GetError())));
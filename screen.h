@@ -14,14 +14,20 @@ class VideoMode
         int height;
         int bpp;
         bool fullScreen;
+        bool accelerated;
 
     public:
-        VideoMode(int w, int h, int bpp, bool fullscreen) 
+        /// Create video mode.
+        /// \param accelerated request hardware surfaces. Software
+        /// surface is used if hardware acceleration is not available.
+        VideoMode(int w, int h, int bpp, bool fullscreen, 
+                bool accelerated=false) 
         { 
             width = w; 
             height = h; 
             this->bpp = bpp; 
             this->fullScreen = fullscreen;
+            this->accelerated = accelerated;
         }
 
     public:
@@ -29,6 +35,7 @@ class VideoMode
         int getHeight() const { return height; };
         int getBpp() const { return bpp; };
         bool isFullScreen() const { return fullScreen; };
+        bool isAccelerated() const { return accelerated; };
 };
 
 
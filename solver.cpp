@@ -0,0 +1,336 @@
+#include <string.h>
+#include <vector>
+#include "solver.h"
+
+
+#define THINGS_CNT  (PUZZLE_SIZE * PUZZLE_SIZE)
+#define ALL_COLS    ((1 << PUZZLE_SIZE) - 1)
+
+
+/// Set of columns, one bit per column.
+typedef unsigned int Cols;
+
+/// Columns where each thing can be placed.
+typedef struct {
+    Cols cols[THINGS_CNT];
+} Field;
+
+
+/// Columns to the right of given columns.
+static inline Cols toRight(Cols c)
+{
+    return (c << 1) & ALL_COLS;
+}
+
+/// Columns to the left of given columns.
+static inline Cols toLeft(Cols c)
+{
+    return c >> 1;
+}
+
+static inline bool isSingle(Cols c)
+{
+    return ! (c & (c - 1));
+}
+
+static inline int countCols(Cols c)
+{
+    int cnt = 0;
+    for (; c; c &= c - 1)
+        cnt++;
+    return cnt;
+}
+
+static inline int getCol(Cols c)
+{
+    int col = 0;
+    while (! (c & (1 << col)))
+        col++;
+    return col;
+}
+
+/// Columns to the left of rightmost column.
+static inline Cols leftOfLast(Cols c)
+{
+    Cols last = 1 << (PUZZLE_SIZE - 1);
+    while (last && ! (c & last))
+        last >>= 1;
+    return last - 1;
+}
+
+/// Columns to the right of leftmost column.
+static inline Cols rightOfFirst(Cols c)
+{
+    Cols first = c & (~c + 1);
+    return ALL_COLS & ~((first << 1) - 1);
+}
+
+
+/// Backtracking search over columns of things.
+/// Every rule narrows sets of columns of its things, every row
+/// keeps its things in different columns.
+class Solver
+{
+    private:
+        std::vector<Rule::Info> rules;
+        int limit;
+        int count;
+        SolvedPuzzle *solution;
+
+    public:
+        Solver(Rules &rules);
+
+    public:
+        int countSolutions(int limit, SolvedPuzzle *solution);
+        bool propagateRules(int *chain);
+
+    private:
+        void reset(Field &field);
+        bool isSolved(Field &field);
+        bool narrow(Field &field, int thing, Cols cols, bool &changed);
+        bool applyRules(Field &from, Field &field, bool &changed);
+        bool applyRows(Field &field, bool &changed);
+        bool closeRows(Field &field);
+        bool propagate(Field &field);
+        void search(Field &field);
+        void storeSolution(Field &field);
+};
+
+
+Solver::Solver(Rules &r)
+{
+    for (Rules::iterator i = r.begin(); i != r.end(); i++)
+        rules.push_back((*i)->getInfo());
+}
+
+void Solver::reset(Field &field)
+{
+    for (int i = 0; i < THINGS_CNT; i++)
+        field.cols[i] = ALL_COLS;
+}
+
+bool Solver::isSolved(Field &field)
+{
+    for (int i = 0; i < THINGS_CNT; i++)
+        if (! isSingle(field.cols[i]))
+            return false;
+    return true;
+}
+
+bool Solver::narrow(Field &field, int thing, Cols cols, bool &changed)
+{
+    Cols c = field.cols[thing] & cols;
+    if (c != field.cols[thing]) {
+        field.cols[thing] = c;
+        changed = true;
+    }
+    return c != 0;
+}
+
+/// Narrow things of field to columns allowed by rules in from field.
+/// Both may be the same field.
+bool Solver::applyRules(Field &from, Field &field, bool &changed)
+{
+    Cols *c = from.cols;
+
+    for (std::vector<Rule::Info>::iterator i = rules.begin();
+            i != rules.end(); i++)
+    {
+        const Rule::Info &r = *i;
+        int t1 = r.thing1, t2 = r.thing2, tc = r.center;
+        bool ok = true;
+
+        switch (r.kind) {
+            case Rule::OPEN_RULE:
+                ok = narrow(field, t1, 1 << r.col, changed);
+                break;
+            case Rule::UNDER_RULE:
+                ok = narrow(field, t1, c[t2], changed) &&
+                    narrow(field, t2, c[t1], changed);
+                break;
+            case Rule::NEAR_RULE:
+                ok = narrow(field, t1, toLeft(c[t2]) | toRight(c[t2]),
+                        changed) &&
+                    narrow(field, t2, toLeft(c[t1]) | toRight(c[t1]),
+                        changed);
+                break;
+            case Rule::DIRECTION_RULE:
+                ok = narrow(field, t1, leftOfLast(c[t2]), changed) &&
+                    narrow(field, t2, rightOfFirst(c[t1]), changed);
+                break;
+            case Rule::BETWEEN_RULE:
+                ok = narrow(field, tc, (toRight(c[t1]) & toLeft(c[t2])) |
+                            (toLeft(c[t1]) & toRight(c[t2])), changed) &&
+                    narrow(field, t1, (toLeft(c[tc]) &
+                                toLeft(toLeft(c[t2]))) | (toRight(c[tc]) &
+                                toRight(toRight(c[t2]))), changed) &&
+                    narrow(field, t2, (toLeft(c[tc]) &
+                                toLeft(toLeft(c[t1]))) | (toRight(c[tc]) &
+                                toRight(toRight(c[t1]))), changed);
+                break;
+        }
+        if (! ok)
+            return false;
+    }
+
+    return true;
+}
+
+bool Solver::applyRows(Field &field, bool &changed)
+{
+    for (int row = 0; row < PUZZLE_SIZE; row++) {
+        Cols *c = field.cols + row * PUZZLE_SIZE;
+
+        // thing placed to single column takes it from other things
+        for (int i = 0; i < PUZZLE_SIZE; i++)
+            if (isSingle(c[i]))
+                for (int j = 0; j < PUZZLE_SIZE; j++)
+                    if ((i != j) && (c[j] & c[i])) {
+                        c[j] &= ~c[i];
+                        if (! c[j])
+                            return false;
+                        changed = true;
+                    }
+
+        // column possible for single thing belongs to that thing
+        Cols once = 0, many = 0;
+        for (int i = 0; i < PUZZLE_SIZE; i++) {
+            many |= once & c[i];
+            once |= c[i];
+        }
+        if (once != ALL_COLS)
+            return false;
+        once &= ~many;
+        if (once)
+            for (int i = 0; i < PUZZLE_SIZE; i++) {
+                Cols own = c[i] & once;
+                if (own && (own != c[i])) {
+                    if (! isSingle(own))
+                        return false;
+                    c[i] = own;
+                    changed = true;
+                }
+            }
+    }
+
+    return true;
+}
+
+bool Solver::closeRows(Field &field)
+{
+    bool changed;
+    do {
+        changed = false;
+        if (! applyRows(field, changed))
+            return false;
+    } while (changed);
+    return true;
+}
+
+bool Solver::propagate(Field &field)
+{
+    bool changed;
+    do {
+        changed = false;
+        if (! applyRules(field, field, changed))
+            return false;
+        if (! applyRows(field, changed))
+            return false;
+    } while (changed);
+    return true;
+}
+
+void Solver::storeSolution(Field &field)
+{
+    for (int row = 0; row < PUZZLE_SIZE; row++)
+        for (int i = 0; i < PUZZLE_SIZE; i++)
+            (*solution)[row][getCol(field.cols[row * PUZZLE_SIZE + i])] =
+                i + 1;
+}
+
+void Solver::search(Field &field)
+{
+    if (! propagate(field))
+        return;
+
+    // branch on thing with fewest columns left
+    int best = -1;
+    int bestCnt = PUZZLE_SIZE + 1;
+    for (int i = 0; i < THINGS_CNT; i++) {
+        Cols c = field.cols[i];
+        if (! isSingle(c)) {
+            int cnt = countCols(c);
+            if (cnt < bestCnt) {
+                best = i;
+                bestCnt = cnt;
+            }
+        }
+    }
+
+    if (best < 0) {
+        if ((! count) && solution)
+            storeSolution(field);
+        count++;
+        return;
+    }
+
+    Cols cols = field.cols[best];
+    for (int col = 0; (col < PUZZLE_SIZE) && (count < limit); col++)
+        if (cols & (1 << col)) {
+            Field f;
+            memcpy(&f, &field, sizeof(Field));
+            f.cols[best] = 1 << col;
+            search(f);
+        }
+}
+
+int Solver::countSolutions(int lim, SolvedPuzzle *sol)
+{
+    limit = lim;
+    solution = sol;
+    count = 0;
+
+    Field field;
+    reset(field);
+    if (limit > 0)
+        search(field);
+    return count;
+}
+
+bool Solver::propagateRules(int *chain)
+{
+    Field field;
+    reset(field);
+
+    if (! chain)
+        return propagate(field) && isSolved(field);
+
+    // every layer applies rules to state of previous layer only
+    *chain = 0;
+    for (;;) {
+        Field next;
+        memcpy(&next, &field, sizeof(Field));
+        bool changed = false;
+        if ((! applyRules(field, next, changed)) || (! closeRows(next)))
+            return false;
+        if (! changed)
+            break;
+        memcpy(&field, &next, sizeof(Field));
+        (*chain)++;
+    }
+    return isSolved(field);
+}
+
+
+int countSolutions(Rules &rules, int limit, SolvedPuzzle *solution)
+{
+    Solver solver(rules);
+    return solver.countSolutions(limit, solution);
+}
+
+bool propagateRules(Rules &rules, int *chain)
+{
+    Solver solver(rules);
+    return solver.propagateRules(chain);
+}
+
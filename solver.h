@@ -0,0 +1,30 @@
+#ifndef __SOLVER_H__
+#define __SOLVER_H__
+
+
+/// \file solver.h
+/// Exact search for puzzle solutions
+
+
+#include "puzgen.h"
+
+
+/// Count solutions of puzzle defined by rules.  Unlike rules propagation
+/// search finds every arrangement of things that satisfies all rules.
+/// \param rules puzzle rules
+/// \param limit counting stops when limit solutions are found
+/// \param solution if not NULL first solution found is stored here
+int countSolutions(Rules &rules, int limit=2, SolvedPuzzle *solution=NULL);
+
+/// Propagate rules without search.  Makes the same deductions as
+/// rules applied to possibilities with single checks, but on columns
+/// masks, so it is fast enough to run on every step of generator.
+/// Returns true if every thing gets single column.
+/// \param rules puzzle rules
+/// \param chain if not NULL number of layers of propagation where
+/// every rule sees only deductions of previous layers is stored here
+bool propagateRules(Rules &rules, int *chain=NULL);
+
+
+#endif
+
@@ -3,55 +3,88 @@
 #include "unicode.h"
 
 
+#define BLOCK_SIZE 4096
+
+
 UtfStreamReader::UtfStreamReader(std::ifstream *s)
 {
     stream = s;
+    bufferPos = 0;
 }
 
 UtfStreamReader::~UtfStreamReader()
 {
 }
 
-// This function is very slow because of poor fromUtf8 function design
-wchar_t UtfStreamReader::getNextChar()
+bool UtfStreamReader::fillBuffer()
 {
-    unsigned char buf[10];
+    if (! stream->good())
+        return false;
 
-    if (0 < backBuf.size()) {
-        wchar_t wc = backBuf.front();
-        backBuf.pop_front();
-        return wc;
-    }
+    char block[BLOCK_SIZE];
+    stream->read(block, BLOCK_SIZE);
+    int size = stream->gcount();
+    if (! size)
+        return false;
+    std::string data(tail);
+    data.append(block, size);
     
-    if (! stream->good())
-        throw Exception(L"Error reading from stream 1");
-
-    int sz = stream->readsome((char*)buf, 1);
-    if (1 != sz)
-        throw Exception(L"Error reading from stream 2");
-    int size = getUtf8Length(buf[0]);
-    if (size > 1) {
-        sz = stream->readsome((char*)buf + 1, size - 1);
-        if (size - 1 != sz)
-            throw Exception(L"Error reading from stream 3");
-    }
-    buf[size] = 0;
-    std::string s((char*)buf);
-    std::wstring ws(fromUtf8(s));
-    if (1 != ws.length())
-        throw Exception(L"Error converting UTF-8 character to wide character");
-    return ws[0];
+    // keep incomplete character at end of block for next time
+    int end = data.length();
+    int start = end - 1;
+    while ((start > 0) && (end - start < 6) && 
+            (0x80 == ((unsigned char)data[start] & 0xc0)))
+        start--;
+    if ((start >= 0) && (0x80 != ((unsigned char)data[start] & 0xc0)) &&
+            (getUtf8Length((unsigned char)data[start]) > end - start))
+        end = start;
+    tail.assign(data, end, data.length() - end);
+
+    buffer = fromUtf8(data.data(), end);
+    bufferPos = 0;
+    return true;
+}
+
+wchar_t UtfStreamReader::getNextChar()
+{
+    while (bufferPos >= (int)buffer.length())
+        if (! fillBuffer())
+            throw Exception(L"Error reading from stream");
+    return buffer[bufferPos++];
 }
 
 void UtfStreamReader::ungetChar(wchar_t ch)
 {
-    backBuf.push_back(ch);
+    if (bufferPos > 0)
+        buffer[--bufferPos] = ch;
+    else
+        buffer.insert(0, 1, ch);
 }
 
 bool UtfStreamReader::isEof()
 {
-    if (stream->eof())
-        return true;     // FIXME: it doesn't work. why?
-    return EOF == stream->peek();
+    while (bufferPos >= (int)buffer.length())
+        if (! fillBuffer()) {
+            if (tail.length())
+                throw Exception(L"Incomplete UTF-8 character at end of file");
+            return true;
+        }
+    return false;
+}
+
+int UtfStreamReader::readWhile(bool (*matches)(wchar_t), std::wstring &str)
+{
+    int count = 0;
+    while (! isEof()) {
+        int start = bufferPos;
+        int len = buffer.length();
+        while ((bufferPos < len) && matches(buffer[bufferPos]))
+            bufferPos++;
+        str.append(buffer, start, bufferPos - start);
+        count += bufferPos - start;
+        if (bufferPos < len)
+            break;
+    }
+    return count;
 }
 
@@ -3,7 +3,7 @@
 
 
 #include <fstream>
-#include <list>
+#include <string>
 
 
 /// Read utf-8 file and convert it to wide characters
@@ -13,8 +13,14 @@ class UtfStreamReader
         /// Pointer to file stream
         std::ifstream *stream;
 
-        /// Push back buffet
-        std::list<wchar_t> backBuf;
+        /// Decoded characters of current block
+        std::wstring buffer;
+
+        /// Position of next character in buffer
+        int bufferPos;
+
+        /// Bytes of incomplete character left from previous block
+        std::string tail;
     
     public:
         /// Create utf-8 stream reader.
@@ -34,6 +40,18 @@ class UtfStreamReader
 
         /// Check if end of file reached.
         bool isEof();
+
+        /// Read characters while they match predicate.
+        /// First non-matching character is left in stream.
+        /// \param matches character predicate
+        /// \param str string where characters will be appended
+        /// \return number of characters read
+        int readWhile(bool (*matches)(wchar_t), std::wstring &str);
+
+    private:
+        /// Read and decode next block of file.
+        /// Returns false if there is no more data.
+        bool fillBuffer();
 };
 
 
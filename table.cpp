@@ -1,6 +1,7 @@
 #include "table.h"
 
 #include <fstream>
+#include <string.h>
 #include "convert.h"
 #include "unicode.h"
 #include "streams.h"
@@ -8,103 +9,16 @@
 #include "exceptions.h"
 
 
-class IntValue: public Value
-{
-    private: 
-        int value;
-    
-    public:
-        IntValue(int val) { value = val; };
-        virtual ~IntValue() { };
-
-    public:
-        virtual Type getType() const { return Value::Integer; };
-        virtual int asInt() const { return value; };
-        virtual double asDouble() const { return value; };
-        virtual std::wstring asString() const { return toString(value); };
-        virtual ::Table* asTable() const { 
-            throw Exception(L"Can't convert integer to table"); 
-        };
-        virtual Value* clone() const { return new IntValue(value); };
-};
-
-
-class DoubleValue: public Value
-{
-    private: 
-        double value;
-    
-    public:
-        DoubleValue(double val) { value = val; };
-        virtual ~DoubleValue() { };
-
-    public:
-        virtual Type getType() const { return Value::Double; };
-        virtual int asInt() const { return (int)value; };
-        virtual double asDouble() const { return value; };
-        virtual std::wstring asString() const { return toString(value); };
-        virtual ::Table* asTable() const { 
-            throw Exception(L"Can't convert double to table"); 
-        };
-        virtual Value* clone() const { return new DoubleValue(value); };
-};
-
-
-class StringValue: public Value
-{
-    private: 
-        std::wstring value;
-    
-    public:
-        StringValue(const std::wstring& val): value(val) { };
-        virtual ~StringValue() { };
-
-    public:
-        virtual Type getType() const { return Value::String; };
-        virtual int asInt() const { return strToInt(value); };
-        virtual double asDouble() const { return strToDouble(value); };
-        virtual std::wstring asString() const { return value; };
-        virtual ::Table* asTable() const { 
-            throw Exception(L"Can't convert string to table"); 
-        };
-        virtual Value* clone() const { return new StringValue(value); };
-};
-
-
-class TableValue: public Value
-{
-    private: 
-        ::Table *value;
-    
-    public:
-        TableValue(::Table *val) { value = val; };
-        virtual ~TableValue() { delete value; };
-
-    public:
-        virtual Type getType() const { return Value::Table; };
-        virtual int asInt() const { 
-            throw Exception(L"Can't convert table to int"); 
-        };
-        virtual double asDouble() const { 
-            throw Exception(L"Can't convert table to double"); 
-        };
-        virtual std::wstring asString() const { 
-            throw Exception(L"Can't convert table to string"); 
-        };
-        virtual ::Table* asTable() const { return value; };
-        virtual Value* clone() const { 
-            return new TableValue(new ::Table(*value)); 
-        };
-};
-
-
 Table::Table(const Table &table)
 {
+    garbage = 0;
+    lastArrayIndex = 0;
     *this = table;
 }
 
 Table::Table(const std::string &fileName)
 {
+    garbage = 0;
     lastArrayIndex = 0;
     std::ifstream stream(fileName.c_str(), 
             std::ios::binary | std::ios::in);
@@ -117,20 +31,32 @@ Table::Table(const std::string &fileName)
 
 Table::Table(Lexal &lexal, int line, int pos)
 {
+    garbage = 0;
     lastArrayIndex = 0;
     parse(lexal, true, line, pos);
 }
 
 Table::Table()
 {
+    garbage = 0;
     lastArrayIndex = 0;
 }
 
 
 Table::~Table()
 {
-    for (ValuesMap::iterator i = fields.begin(); i != fields.end(); i++)
-        delete (*i).second;
+    clear();
+}
+
+
+void Table::clear()
+{
+    for (Fields::iterator i = fields.begin(); i != fields.end(); i++)
+        if (Value::Table == (*i).value.type)
+            delete (*i).value.table;
+    fields.clear();
+    pool.clear();
+    garbage = 0;
 }
 
 
@@ -139,31 +65,40 @@ Table& Table::operator = (const Table &table)
     if (this == &table) 
         return *this;
 
-    fields.clear();
+    clear();
+    fields = table.fields;
+    pool = table.pool;
+    garbage = table.garbage;
     lastArrayIndex = table.lastArrayIndex;
-    for (ValuesMap::const_iterator i = table.fields.begin(); 
-            i != table.fields.end(); i++)
-        fields[(*i).first] = (*i).second->clone();
+    for (Fields::iterator i = fields.begin(); i != fields.end(); i++)
+        if (Value::Table == (*i).value.type)
+            (*i).value.table = new Table(*(*i).value.table);
     
     return *this;
 }
 
 
-static Value* lexToValue(Lexal &lexal, const Lexeme &lexeme)
+void Table::setLexeme(Lexal &lexal, const std::wstring &key, 
+        const Lexeme &lexeme)
 {
     switch (lexeme.getType())
     {
         case Lexeme::Ident:
         case Lexeme::String: 
-            return new StringValue(lexeme.getContent());
+            setString(key, lexeme.getContent());
+            return;
         case Lexeme::Integer: 
-            return new IntValue(strToInt(lexeme.getContent()));
+            setInt(key, strToInt(lexeme.getContent()));
+            return;
         case Lexeme::Float: 
-            return new DoubleValue(strToDouble(lexeme.getContent()));
+            setDouble(key, strToDouble(lexeme.getContent()));
+            return;
         case Lexeme::Symbol: 
-            if (L"{" == lexeme.getContent())
-                return new TableValue(new Table(lexal, lexeme.getLine(),
+            if (L"{" == lexeme.getContent()) {
+                setTable(key, new Table(lexal, lexeme.getLine(),
                             lexeme.getPos()));
+                return;
+            }
         default:
             throw Exception(L"Invalid lexeme type at " + lexeme.getPosStr());
     }
@@ -175,12 +110,12 @@ void Table::addValuePair(Lexal &lexal, const std::wstring &name)
     Lexeme lex = lexal.getNext();
     if (Lexeme::Eof == lex.getType())
         throw Exception(L"Unexpected end of file");
-    fields[name] = lexToValue(lexal, lex);
+    setLexeme(lexal, name, lex);
 }
 
 void Table::addArrayElement(Lexal &lexal, const Lexeme &lexeme)
 {
-    fields[numToStr(lastArrayIndex)] = lexToValue(lexal, lexeme);
+    setLexeme(lexal, numToStr(lastArrayIndex), lexeme);
     lastArrayIndex++;
 }
 
@@ -190,10 +125,10 @@ void Table::parse(Lexal &lexal, bool needBracket, int startLine, int startPos)
     bool read = true;
     
     while (true) {
-        if (read) {
+        if (read)
             lex = lexal.getNext();
+        else
             read = true;
-        }
         Lexeme::Type type = lex.getType();
         if (Lexeme::Eof == type) {
             if (! needBracket)
@@ -228,7 +163,7 @@ void Table::parse(Lexal &lexal, bool needBracket, int startLine, int startPos)
 
 bool Table::hasKey(const std::wstring &key) const
 {
-    return (fields.end() != fields.find(key));
+    return NULL != findField(key);
 }
 
 
@@ -255,34 +190,6 @@ static std::wstring encodeString(const std::wstring &str)
     return res;
 }
 
-static std::wstring printValue(Value *value, bool butify, int spaces)
-{
-    if (! value)
-        return L"";
-
-    switch (value->getType()) {
-        case Value::Integer: 
-            return toString(value->asInt());
-            
-        case Value::Double: 
-            {
-                std::wstring s = toString(value->asDouble());
-                if (s.find(L'.') >= s.length())
-                    s.append(L".0");
-                return s;
-            }
-            
-        case Value::String: 
-            return encodeString(value->asString());
-
-        case Value::Table: 
-            return value->asTable()->toString(true, butify, spaces);
-    }
-        
-    return L"";
-}
-
-
 bool Table::isArray() const
 {
     int size = fields.size();
@@ -322,11 +229,9 @@ std::wstring Table::toString(bool printBraces, bool butify, int spaces) const
         res += butify ? L"{\n" : L"{";
     bool printNames = ! isArray();
 
-    for (ValuesMap::const_iterator i = fields.begin(); i != fields.end(); 
-            i++) 
-    {
-        const std::wstring &name = (*i).first;
-        Value *value = (*i).second;
+    for (Fields::const_iterator i = fields.begin(); i != fields.end(); i++) {
+        std::wstring name(getKey(*i));
+        const Value &value = (*i).value;
         if (butify)
             for (int j = 0; j < spaces; j++) 
                 res += L" ";
@@ -334,7 +239,25 @@ std::wstring Table::toString(bool printBraces, bool butify, int spaces) const
             res += L" ";
         if (printNames && (! isInteger(name)))
             res += name + L" = ";
-        res += printValue(value, butify, spaces + 4);
+        switch (value.type) {
+            case Value::Integer: 
+                res += ::toString(value.intValue);
+                break;
+            case Value::Double: 
+                {
+                    std::wstring s = ::toString(value.doubleValue);
+                    if (s.find(L'.') >= s.length())
+                        s.append(L".0");
+                    res += s;
+                }
+                break;
+            case Value::String: 
+                res += encodeString(asString(value));
+                break;
+            case Value::Table: 
+                res += value.table->toString(true, butify, spaces + 4);
+                break;
+        }
         if (printNames)
             res += butify ? L";\n" : L";";
         else
@@ -356,66 +279,331 @@ std::wstring Table::toString(bool printBraces, bool butify, int spaces) const
 }
 
 
+const Table::Field* Table::findField(const std::wstring &key) const
+{
+    int lo = 0, hi = fields.size();
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        const Field &f = fields[mid];
+        int cmp = pool.compare(f.keyOffset, f.keyLength, key);
+        if (! cmp)
+            return &f;
+        else if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return NULL;
+}
+
+
+std::wstring Table::getKey(const Field &field) const
+{
+    return pool.substr(field.keyOffset, field.keyLength);
+}
+
+
+std::wstring Table::asString(const Value &value) const
+{
+    switch (value.type) {
+        case Value::Integer: return ::toString(value.intValue);
+        case Value::Double: return ::toString(value.doubleValue);
+        case Value::String: 
+            return pool.substr(value.str.offset, value.str.length);
+        default:
+            throw Exception(L"Can't convert table to string"); 
+    }
+}
+
+int Table::asInt(const Value &value) const
+{
+    switch (value.type) {
+        case Value::Integer: return value.intValue;
+        case Value::Double: return (int)value.doubleValue;
+        case Value::String: return strToInt(asString(value));
+        default:
+            throw Exception(L"Can't convert table to int"); 
+    }
+}
+
+double Table::asDouble(const Value &value) const
+{
+    switch (value.type) {
+        case Value::Integer: return value.intValue;
+        case Value::Double: return value.doubleValue;
+        case Value::String: return strToDouble(asString(value));
+        default:
+            throw Exception(L"Can't convert table to double"); 
+    }
+}
+
+
 Value::Type Table::getType(const std::wstring &key) const
 {
-    ValuesMap::const_iterator i = fields.find(key);
-    if (i == fields.end())
+    const Field *f = findField(key);
+    if (! f)
         throw Exception(L"Field '" + key + L"' doesn't exists in the table");
-    return (*i).second->getType();
+    return f->value.type;
 }
 
 
 std::wstring Table::getString(const std::wstring &key, 
         const std::wstring &dflt) const
 {
-    ValuesMap::const_iterator i = fields.find(key);
-    return (i != fields.end()) ? (*i).second->asString() : dflt;
+    const Field *f = findField(key);
+    return f ? asString(f->value) : dflt;
 }
 
 int Table::getInt(const std::wstring &key, int dflt) const
 {
-    ValuesMap::const_iterator i = fields.find(key);
-    return (i != fields.end()) ? ((*i).second ? (*i).second->asInt() : dflt) : dflt;
+    const Field *f = findField(key);
+    return f ? asInt(f->value) : dflt;
 }
 
 double Table::getDouble(const std::wstring &key, double dflt) const
 {
-    ValuesMap::const_iterator i = fields.find(key);
-    return (i != fields.end()) ? (*i).second->asDouble() : dflt;
+    const Field *f = findField(key);
+    return f ? asDouble(f->value) : dflt;
 }
 
 Table* Table::getTable(const std::wstring &key, Table *dflt) const
 {
-    ValuesMap::const_iterator i = fields.find(key);
-    return (i != fields.end()) ? (*i).second->asTable() : dflt;
+    const Field *f = findField(key);
+    if (! f)
+        return dflt;
+    if (Value::Table != f->value.type)
+        throw Exception(L"Can't convert value to table");
+    return f->value.table;
+}
+
+
+Value Table::makeString(const std::wstring &str)
+{
+    Value v;
+    v.type = Value::String;
+    v.str.offset = pool.length();
+    v.str.length = str.length();
+    pool += str;
+    return v;
 }
 
-void Table::setValue(const std::wstring &key, Value *value)
+void Table::freeValue(const Value &value)
 {
-    ValuesMap::const_iterator i = fields.find(key);
-    if (i != fields.end())
-        delete (*i).second;
-    fields[key] = value;
+    if (Value::String == value.type)
+        garbage += value.str.length;
+    else if (Value::Table == value.type)
+        delete value.table;
+}
+
+void Table::compactPool()
+{
+    std::wstring newPool;
+    newPool.reserve(pool.length() - garbage);
+    for (Fields::iterator i = fields.begin(); i != fields.end(); i++) {
+        Field &f = *i;
+        int offset = newPool.length();
+        newPool.append(pool, f.keyOffset, f.keyLength);
+        f.keyOffset = offset;
+        if (Value::String == f.value.type) {
+            offset = newPool.length();
+            newPool.append(pool, f.value.str.offset, f.value.str.length);
+            f.value.str.offset = offset;
+        }
+    }
+    pool.swap(newPool);
+    garbage = 0;
+}
+
+void Table::setValue(const std::wstring &key, const Value &value)
+{
+    int lo = 0, hi = fields.size();
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        Field &f = fields[mid];
+        int cmp = pool.compare(f.keyOffset, f.keyLength, key);
+        if (! cmp) {
+            freeValue(f.value);
+            f.value = value;
+            if (garbage > (int)pool.length() / 2)
+                compactPool();
+            return;
+        } else if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    
+    Field f;
+    f.keyOffset = pool.length();
+    f.keyLength = key.length();
+    f.value = value;
+    pool += key;
+    fields.insert(fields.begin() + lo, f);
 }
 
 void Table::setString(const std::wstring &key, const std::wstring &value)
 {
-    setValue(key, new StringValue(value));
+    setValue(key, makeString(value));
 }
 
 void Table::setInt(const std::wstring &key, int value)
 {
-    setValue(key, new IntValue(value));
+    Value v;
+    v.type = Value::Integer;
+    v.intValue = value;
+    setValue(key, v);
 }
 
 void Table::setDouble(const std::wstring &key, double value)
 {
-    setValue(key, new DoubleValue(value));
+    Value v;
+    v.type = Value::Double;
+    v.doubleValue = value;
+    setValue(key, v);
 }
 
 void Table::setTable(const std::wstring &key, Table *value)
 {
-    setValue(key, new TableValue(value));
+    Value v;
+    v.type = Value::Table;
+    v.table = value;
+    setValue(key, v);
+}
+
+
+/// Sequential reader of snapshot data.
+class SnapshotReader
+{
+    private:
+        const unsigned char *pos;
+        const unsigned char *end;
+
+    public:
+        SnapshotReader(const char *data, int size) {
+            pos = (const unsigned char*)data;
+            end = pos + size;
+        };
+
+    public:
+        void read(void *buf, int size) {
+            need(size);
+            memcpy(buf, pos, size);
+            pos += size;
+        };
+        
+        int readByte() {
+            need(1);
+            return *pos++;
+        };
+
+        int readInt() {
+            need(4);
+            int v = pos[0] | (pos[1] << 8) | (pos[2] << 16) | (pos[3] << 24);
+            pos += 4;
+            return v;
+        };
+
+        std::wstring readString() {
+            int len = readInt();
+            need(len);
+            const char *s = (const char*)pos;
+            pos += len;
+            return fromUtf8(s, len);
+        };
+
+    private:
+        void need(int size) {
+            if ((size < 0) || (end - pos < size))
+                throw Exception(L"Snapshot is truncated");
+        };
+};
+
+
+static void writeSnapshotInt(std::ostream &stream, int v)
+{
+    char b[4] = { (char)(v & 0xFF), (char)((v >> 8) & 0xFF), 
+        (char)((v >> 16) & 0xFF), (char)((v >> 24) & 0xFF) };
+    stream.write(b, 4);
+}
+
+static void writeSnapshotString(std::ostream &stream, const std::wstring &s)
+{
+    std::string utf(toUtf8(s));
+    writeSnapshotInt(stream, utf.length());
+    stream.write(utf.data(), utf.length());
+}
+
+
+void Table::writeSnapshot(std::ostream &stream) const
+{
+    writeSnapshotInt(stream, lastArrayIndex);
+    writeSnapshotInt(stream, fields.size());
+    for (Fields::const_iterator i = fields.begin(); i != fields.end(); i++) {
+        const Value &value = (*i).value;
+        writeSnapshotString(stream, getKey(*i));
+        stream.put((char)value.type);
+        switch (value.type) {
+            case Value::Integer:
+                writeSnapshotInt(stream, value.intValue);
+                break;
+            case Value::Double:
+                stream.write((const char*)&value.doubleValue, sizeof(double));
+                break;
+            case Value::String:
+                writeSnapshotString(stream, asString(value));
+                break;
+            case Value::Table:
+                value.table->writeSnapshot(stream);
+                break;
+        }
+    }
+}
+
+
+void Table::readSnapshot(const char *data, int size)
+{
+    SnapshotReader reader(data, size);
+    readSnapshot(reader);
+}
+
+
+void Table::readSnapshot(SnapshotReader &reader)
+{
+    clear();
+    lastArrayIndex = reader.readInt();
+    int cnt = reader.readInt();
+    for (int i = 0; i < cnt; i++) {
+        std::wstring key(reader.readString());
+        switch (reader.readByte()) {
+            case Value::Integer:
+                setInt(key, reader.readInt());
+                break;
+            case Value::Double:
+                {
+                    double d;
+                    reader.read(&d, sizeof(d));
+                    setDouble(key, d);
+                }
+                break;
+            case Value::String:
+                setString(key, reader.readString());
+                break;
+            case Value::Table:
+                {
+                    ::Table *table = new ::Table();
+                    try {
+                        table->readSnapshot(reader);
+                    } catch (...) {
+                        delete table;
+                        throw;
+                    }
+                    setTable(key, table);
+                }
+                break;
+            default:
+                throw Exception(L"Invalid value type in snapshot");
+        }
+    }
 }
 
 
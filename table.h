@@ -3,13 +3,17 @@
 
 
 #include <string>
-#include <map>
+#include <vector>
 #include "lexal.h"
 
 
 class Table;
+class SnapshotReader;
 
 
+/// Table field value.
+/// Strings are stored in character pool of the owning table,
+/// nested tables are owned by the table.
 class Value
 {
     public:
@@ -21,26 +25,33 @@ class Value
         };
     
     public:
-        virtual ~Value() { };
-
-    public:
-        virtual ::Table* asTable() const = 0;
-        virtual Type getType() const = 0;
-        virtual int asInt() const = 0;
-        virtual double asDouble() const = 0;
-        virtual std::wstring asString() const = 0;
-        virtual Value* clone() const = 0;
+        Type type;
+        union {
+            int intValue;
+            double doubleValue;
+            struct {
+                int offset;
+                int length;
+            } str;
+            ::Table *table;
+        };
 };
 
 
 class Table
 {
-    public:
-        typedef std::map<std::wstring, Value*> ValuesMap;
-        typedef ValuesMap::const_iterator Iterator;
+    private:
+        typedef struct {
+            int keyOffset;
+            int keyLength;
+            Value value;
+        } Field;
+        typedef std::vector<Field> Fields;
         
     private:
-        ValuesMap fields;
+        Fields fields;          /// fields sorted by key
+        std::wstring pool;      /// keys and string values
+        int garbage;            /// number of unused characters in pool
         int lastArrayIndex;
     
     public:
@@ -56,10 +67,18 @@ class Table
         std::wstring toString(bool printBraces, bool butify, int ident) const;
         bool isArray() const;
         void save(const std::wstring &fileName) const;
+        
+        /// Write table in compact binary form.
+        void writeSnapshot(std::ostream &stream) const;
+        
+        /// Replace table contents with data written by writeSnapshot.
+        /// Keys and values are copied to the heap, only text parsing
+        /// is skipped.
+        /// \param data snapshot data.
+        /// \param size size of data in bytes.
+        void readSnapshot(const char *data, int size);
 
     public:
-        Iterator begin() const { return fields.begin(); };
-        Iterator end() const { return fields.end(); };
         bool hasKey(const std::wstring &key) const;
         Value::Type getType(const std::wstring &key) const;
         std::wstring getString(const std::wstring &key, const std::wstring &dflt = L"") const;
@@ -75,10 +94,32 @@ class Table
         void parse(Lexal &lexal, bool needBracket, int startLine, int startPos);
         void addArrayElement(Lexal &lexal, const Lexeme &lexeme);
         void addValuePair(Lexal &lexal, const std::wstring &name);
-        void setValue(const std::wstring &key, Value *value);
+        void setLexeme(Lexal &lexal, const std::wstring &key, 
+                const Lexeme &lexeme);
+        void readSnapshot(SnapshotReader &reader);
+        void clear();
+        
+        /// Find field by key.  Returns NULL if there is no such field.
+        const Field* findField(const std::wstring &key) const;
+        
+        /// Set value of field.  Value must be allocated in this table.
+        void setValue(const std::wstring &key, const Value &value);
+        
+        /// Copy string into the pool.
+        Value makeString(const std::wstring &str);
+        
+        /// Release memory used by value.
+        void freeValue(const Value &value);
+        
+        /// Remove unused strings from the pool.
+        void compactPool();
+        
+        std::wstring getKey(const Field &field) const;
+        std::wstring asString(const Value &value) const;
+        int asInt(const Value &value) const;
+        double asDouble(const Value &value) const;
 };
 
 
 
 #endif
-
@@ -1,15 +1,49 @@
 #include <iostream>
 #include <fstream>
 #include <stdlib.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 #include "tablestorage.h"
 #include "unicode.h"
 #include "exceptions.h"
+#include "utils.h"
+
+
+#define WRITE_DELAY         1000
+
+#define SNAPSHOT_MAGIC      0x42435245
+#define SNAPSHOT_VERSION    1
+
+
+/// Snapshot file header
+typedef struct {
+    int magic;
+    int version;
+    long configSize;        /// size of config file snapshot was made from
+    long configTime;        /// modification time of that config file
+    long configTimeNsec;    /// nanoseconds part of modification time
+} SnapshotHeader;
 
 
 TableStorage::TableStorage()
 {
+    mutex = SDL_CreateMutex();
+    fileMutex = SDL_CreateMutex();
+    changed = SDL_CreateCond();
+    writer = NULL;
+    dirty = false;
+    finish = false;
+    changeTime = 0;
+    
     try {
-        table = Table(toMbcs(getFileName()));
+        if (! loadSnapshot())
+            table = Table(toMbcs(getFileName()));
     } catch (Exception &e) {
         std::cerr << e.getMessage() << std::endl;
     } catch (...) {
@@ -19,7 +53,58 @@ TableStorage::TableStorage()
 
 TableStorage::~TableStorage()
 {
+    if (writer) {
+        SDL_LockMutex(mutex);
+        finish = true;
+        SDL_CondSignal(changed);
+        SDL_UnlockMutex(mutex);
+        SDL_WaitThread(writer, NULL);
+    }
     flush();
+    SDL_DestroyCond(changed);
+    SDL_DestroyMutex(fileMutex);
+    SDL_DestroyMutex(mutex);
+}
+
+
+int writerThread(void *storage)
+{
+    ((TableStorage*)storage)->runWriter();
+    return 0;
+}
+
+void TableStorage::runWriter()
+{
+    SDL_LockMutex(mutex);
+    while (! finish) {
+        if (! dirty) {
+            SDL_CondWait(changed, mutex);
+            continue;
+        }
+        Uint32 elapsed = SDL_GetTicks() - changeTime;
+        if (elapsed < WRITE_DELAY) {
+            SDL_CondWaitTimeout(changed, mutex, WRITE_DELAY - elapsed);
+            continue;
+        }
+        
+        SDL_LockMutex(fileMutex);
+        Table copy(table);
+        dirty = false;
+        SDL_UnlockMutex(mutex);
+        write(copy);
+        SDL_UnlockMutex(fileMutex);
+        SDL_LockMutex(mutex);
+    }
+    SDL_UnlockMutex(mutex);
+}
+
+void TableStorage::touch()
+{
+    dirty = true;
+    changeTime = SDL_GetTicks();
+    if (! writer)
+        writer = SDL_CreateThread(writerThread, this);
+    SDL_CondSignal(changed);
 }
 
 std::wstring TableStorage::getFileName()
@@ -31,6 +116,87 @@ std::wstring TableStorage::getFileName()
 #endif
 }
 
+std::wstring TableStorage::getSnapshotFileName()
+{
+    return getFileName() + L".cache";
+}
+
+static bool getConfigStamp(const std::wstring &fileName, SnapshotHeader &h)
+{
+    struct stat buf;
+    if (stat(toMbcs(fileName).c_str(), &buf))
+        return false;
+    h.magic = SNAPSHOT_MAGIC;
+    h.version = SNAPSHOT_VERSION;
+    h.configSize = buf.st_size;
+    h.configTime = buf.st_mtime;
+#if defined(__APPLE__)
+    h.configTimeNsec = buf.st_mtimespec.tv_nsec;
+#elif defined(WIN32)
+    h.configTimeNsec = 0;
+#else
+    h.configTimeNsec = buf.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+bool TableStorage::loadSnapshot()
+{
+    SnapshotHeader stamp;
+    if (! getConfigStamp(getFileName(), stamp))
+        return false;
+
+    bool loaded = false;
+    std::string name(toMbcs(getSnapshotFileName()));
+#ifndef WIN32
+    int fd = open(name.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat buf;
+    if ((! fstat(fd, &buf)) && (buf.st_size >= (long)sizeof(SnapshotHeader))) {
+        void *data = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED != data) {
+            const SnapshotHeader *h = (const SnapshotHeader*)data;
+            if ((h->magic == stamp.magic) && (h->version == stamp.version) &&
+                    (h->configSize == stamp.configSize) && 
+                    (h->configTime == stamp.configTime) &&
+                    (h->configTimeNsec == stamp.configTimeNsec)) 
+            {
+                try {
+                    table.readSnapshot((const char*)data + 
+                            sizeof(SnapshotHeader), 
+                            buf.st_size - sizeof(SnapshotHeader));
+                    loaded = true;
+                } catch (Exception &e) {
+                    // broken snapshot, config file will be parsed
+                }
+            }
+            munmap(data, buf.st_size);
+        }
+    }
+    close(fd);
+#endif
+    return loaded;
+}
+
+void TableStorage::saveSnapshot(const Table &table)
+{
+    SnapshotHeader h;
+    if (! getConfigStamp(getFileName(), h))
+        return;
+    std::string name(toMbcs(getSnapshotFileName()));
+    std::string tmpName(name + ".tmp");
+    std::ofstream stream(tmpName.c_str(), std::ios::out | std::ios::binary);
+    if (! stream.good())
+        return;
+    stream.write((const char*)&h, sizeof(h));
+    table.writeSnapshot(stream);
+    bool ok = stream.good();
+    stream.close();
+    if ((! ok) || (! replaceFile(tmpName, name)))
+        remove(tmpName.c_str());
+}
+
 int TableStorage::get(const std::wstring &name, int dflt)
 {
     return table.getInt(name, dflt);
@@ -44,16 +210,47 @@ std::wstring TableStorage::get(const std::wstring &name,
 
 void TableStorage::set(const std::wstring &name, int value)
 {
+    SDL_LockMutex(mutex);
     table.setInt(name, value);
+    touch();
+    SDL_UnlockMutex(mutex);
 }
 
 void TableStorage::set(const std::wstring &name, const std::wstring &value)
 {
+    SDL_LockMutex(mutex);
     table.setString(name, value);
+    touch();
+    SDL_UnlockMutex(mutex);
+}
+
+void TableStorage::write(const Table &table)
+{
+    std::wstring fileName(getFileName());
+    std::wstring tmpName(fileName + L".tmp");
+    try {
+        table.save(tmpName);
+        if (! replaceFile(toMbcs(tmpName), toMbcs(fileName)))
+            throw Exception(L"Can't rename '" + tmpName + L"' to '" + 
+                    fileName + L"'");
+        saveSnapshot(table);
+    } catch (Exception &e) {
+        remove(toMbcs(tmpName).c_str());
+        std::cerr << e.getMessage() << std::endl;
+    }
 }
 
 void TableStorage::flush()
 {
-    table.save(getFileName());
+    SDL_LockMutex(mutex);
+    SDL_LockMutex(fileMutex);
+    if (dirty) {
+        Table copy(table);
+        dirty = false;
+        SDL_UnlockMutex(mutex);
+        write(copy);
+    } else
+        SDL_UnlockMutex(mutex);
+    SDL_UnlockMutex(fileMutex);
 }
 
@@ -2,14 +2,26 @@
 #define __TABLESTORAGE_H__
 
 
+#include <SDL/SDL_thread.h>
 #include "storage.h"
 #include "table.h"
 
 
+/// Storage in config file.
+/// Changes are written by background thread when no more changes
+/// were made for a while.  flush() writes pending changes immediately
+/// and waits until file is written.
 class TableStorage: public Storage
 {
     private:
         Table table;
+        SDL_mutex *mutex;       /// protects table and write state
+        SDL_mutex *fileMutex;   /// held while config file is written
+        SDL_cond *changed;      /// signalled when table is changed
+        SDL_Thread *writer;     /// background writer thread
+        bool dirty;             /// table has unsaved changes
+        bool finish;            /// writer thread should exit
+        Uint32 changeTime;      /// time of last change
     
     public:
         TableStorage();
@@ -24,7 +36,28 @@ class TableStorage: public Storage
         virtual void flush();
 
     private:
+        friend int writerThread(void *storage);
+        
+        /// Background writer loop.
+        void runWriter();
+        
+        /// Mark table changed and wake writer.  Mutex must be locked.
+        void touch();
+
+        /// Write table to config file and snapshot.
+        void write(const Table &table);
+        
         std::wstring getFileName();
+        std::wstring getSnapshotFileName();
+
+        /// Load table from binary snapshot if it was made from
+        /// current version of config file.  Snapshot is a parse-skipping
+        /// cache: it is mapped only while table is decoded from it and
+        /// lookups go to the table as usual.
+        bool loadSnapshot();
+
+        /// Write binary snapshot of config file.
+        void saveSnapshot(const Table &table);
 };
 
 
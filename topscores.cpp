@@ -74,7 +74,6 @@ void TopScores::save()
         no++;
     }
     
-    storage->flush();
     modifed = false;
 }
 
@@ -67,21 +67,6 @@ static const char utf8_skip_data[256] = {
 
 const char * const g_utf8_skip = utf8_skip_data;
 
-#define g_utf8_next_char(p) (char *)((p) + g_utf8_skip[*(unsigned char *)(p)])
-
-#define UTF8_GET(Result, Chars, Count, Mask, Len)			      \
-  (Result) = (Chars)[0] & (Mask);					      \
-  for ((Count) = 1; (Count) < (Len); ++(Count))				      \
-    {									      \
-      if (((Chars)[(Count)] & 0xc0) != 0x80)				      \
-	{								      \
-	  (Result) = -1;						      \
-	  break;							      \
-	}								      \
-      (Result) <<= 6;							      \
-      (Result) |= ((Chars)[(Count)] & 0x3f);				      \
-    }
-
 /* Like g_utf8_get_char, but take a maximum length
  * and return (wchar_t)-2 on incomplete trailing character
  */
@@ -162,118 +147,6 @@ g_utf8_get_char_extended (const  char *p,
   return wc;
 }
 
-/**
- * g_utf8_get_char:
- * @p: a pointer to Unicode character encoded as UTF-8
- * 
- * Converts a sequence of bytes encoded as UTF-8 to a Unicode character.
- * If @p does not point to a valid UTF-8 encoded character, results are
- * undefined. If you are not sure that the bytes are complete
- * valid Unicode characters, you should use g_utf8_get_char_validated()
- * instead.
- * 
- * Return value: the resulting character
- **/
-wchar_t
-g_utf8_get_char (const char *p)
-{
-  int i, mask = 0, len;
-  wchar_t result;
-  unsigned char c = (unsigned char) *p;
-
-  UTF8_COMPUTE (c, mask, len);
-  if (len == -1)
-    return (wchar_t)-1;
-  UTF8_GET (result, p, i, mask, len);
-
-  return result;
-}
-
-
-/**
- * g_utf8_to_ucs4:
- * @str: a UTF-8 encoded string
- * @len: the maximum length of @str to use. If @len < 0, then
- *       the string is nul-terminated.
- * @items_read: location to store number of bytes read, or %NULL.
- *              If %NULL, then %G_CONVERT_ERROR_PARTIAL_INPUT will be
- *              returned in case @str contains a trailing partial
- *              character. If an error occurs then the index of the
- *              invalid input is stored here.
- * @items_written: location to store number of characters written or %NULL.
- *                 The value here stored does not include the trailing 0
- *                 character. 
- * @error: location to store the error occuring, or %NULL to ignore
- *         errors. Any of the errors in #GConvertError other than
- *         %G_CONVERT_ERROR_NO_CONVERSION may occur.
- *
- * Convert a string from UTF-8 to a 32-bit fixed width
- * representation as UCS-4. A trailing 0 will be added to the
- * string after the converted text.
- * 
- * Return value: a pointer to a newly allocated UCS-4 string.
- *               This value must be freed with g_free(). If an
- *               error occurs, %NULL will be returned and
- *               @error set.
- **/
-wchar_t *
-g_utf8_to_ucs4 (const char *str,
-		long        len,             
-		long       *items_read,      
-		long       *items_written,   
-		wchar_t **error)
-{
-  wchar_t *result = NULL;
-  int n_chars, i;
-  const char *in;
-  
-  in = str;
-  n_chars = 0;
-  while ((len < 0 || str + len - in > 0) && *in)
-    {
-      wchar_t wc = g_utf8_get_char_extended (in, str + len - in);
-      if (wc & 0x80000000)
-	{
-	  if (wc == (wchar_t)-2)
-	    {
-	      if (items_read)
-		break;
-	      else
-                if (error)
-		  *error = L"Partial character sequence at end of input";
-	    }
-	  else
-            if (error)
-              *error = L"Invalid byte sequence in conversion input";
-
-	  goto err_out;
-	}
-
-      n_chars++;
-
-      in = g_utf8_next_char (in);
-    }
-
-  result = (wchar_t*)malloc((n_chars + 1) * sizeof(wchar_t));
-  
-  in = str;
-  for (i=0; i < n_chars; i++)
-    {
-      result[i] = g_utf8_get_char (in);
-      in = g_utf8_next_char (in);
-    }
-  result[i] = 0;
-
-  if (items_written)
-    *items_written = n_chars;
-
- err_out:
-  if (items_read)
-    *items_read = in - str;
-
-  return result;
-}
-
 /**
  * g_unichar_to_utf8:
  * @c: a ISO10646 character code
@@ -337,114 +210,104 @@ g_unichar_to_utf8 (wchar_t c,
   return len;
 }
 
-/**
- * g_ucs4_to_utf8:
- * @str: a UCS-4 encoded string
- * @len: the maximum length of @str to use. If @len < 0, then
- *       the string is terminated with a 0 character.
- * @items_read: location to store number of characters read read, or %NULL.
- * @items_written: location to store number of bytes written or %NULL.
- *                 The value here stored does not include the trailing 0
- *                 byte. 
- * @error: location to store the error occuring, or %NULL to ignore
- *         errors. Any of the errors in #GConvertError other than
- *         %G_CONVERT_ERROR_NO_CONVERSION may occur.
- *
- * Convert a string from a 32-bit fixed width representation as UCS-4.
- * to UTF-8. The result will be terminated with a 0 byte.
- * 
- * Return value: a pointer to a newly allocated UTF-8 string.
- *               This value must be freed with g_free(). If an
- *               error occurs, %NULL will be returned and
- *               @error set.
- **/
-char *
-g_ucs4_to_utf8 (const wchar_t *str,
-		long           len,              
-		long          *items_read,       
-		long          *items_written,    
-		wchar_t       **error)
-{
-  int result_length;
-  char *result = NULL;
-  char *p;
-  int i;
-
-  result_length = 0;
-  for (i = 0; len < 0 || i < len ; i++)
-    {
-      if (!str[i])
-	break;
-
-      if ((unsigned)str[i] >= 0x80000000)
-	{
-	  if (items_read)
-	    *items_read = i;
-          if (error)
-              *error = L"Character out of range for UTF-8";
-	  goto err_out;
-	}
-      
-      result_length += UTF8_LENGTH (str[i]);
-    }
-
-  result = (char*)malloc (result_length + 1);
-  p = result;
-
-  i = 0;
-  while (p < result + result_length)
-    p += g_unichar_to_utf8 (str[i++], p);
-  
-  *p = '\0';
-
-  if (items_written)
-    *items_written = p - result;
+/// Word used to test several bytes at once.
+typedef unsigned long Word;
 
- err_out:
-  if (items_read)
-    *items_read = i;
+#define WORD_ONES  ((Word)-1 / 0xff)
+#define WORD_HIGHS (WORD_ONES * 0x80)
 
-  return result;
+/// Returns true if all bytes of word are non-zero 7-bit characters.
+static inline bool isAsciiWord(Word w)
+{
+    return ! ((w | ((w - WORD_ONES) & ~w)) & WORD_HIGHS);
 }
 
 std::string toUtf8(const std::wstring &str)
 {
-    long readed, writed;
-    wchar_t *errMsg = NULL;
+    const wchar_t *src = str.data();
+    int len = str.length();
     
-    char *res = g_ucs4_to_utf8(str.c_str(), str.length(), &readed,
-            &writed, &errMsg);
-    if (! res) {
-        if (errMsg)
-            throw Exception(errMsg);
-        else
-            throw Exception(L"Error converting text to UTF-8");
+    // conversion stops at first 0 character
+    int size = 0;
+    int cnt;
+    for (cnt = 0; cnt < len; cnt++) {
+        wchar_t c = src[cnt];
+        if (! c)
+            break;
+        if ((unsigned)c >= 0x80000000)
+            throw Exception(L"Character out of range for UTF-8");
+        size += UTF8_LENGTH((unsigned)c);
     }
 
-    std::string s(res);
-    free(res);
-
-    return s;
+    std::string res;
+    if (! size)
+        return res;
+    res.resize(size);
+    char *p = &res[0];
+    if (size == cnt)
+        for (int i = 0; i < cnt; i++)
+            p[i] = (char)src[i];
+    else
+        for (int i = 0; i < cnt; i++) {
+            if (src[i] < 0x80)
+                *p++ = (char)src[i];
+            else
+                p += g_unichar_to_utf8(src[i], p);
+        }
+    return res;
 }
 
-std::wstring fromUtf8(const std::string &str)
+std::wstring fromUtf8(const char *str, int len)
 {
-    long readed, writed;
-    wchar_t *errMsg = NULL;
+    std::wstring res;
+    if (len <= 0)
+        return res;
+    
+    // result is never longer than input
+    res.resize(len);
+    wchar_t *out = &res[0];
+    const unsigned char *p = (const unsigned char*)str;
+    const unsigned char *end = p + len;
     
-    wchar_t *res = g_utf8_to_ucs4(str.c_str(), str.length(), &readed,
-            &writed, &errMsg);
-    if (! res) {
-        if (errMsg)
-            throw Exception(errMsg);
-        else
-            throw Exception(L"Error converting text from UTF-8");
+    while (p < end) {
+        while ((end - p) >= (int)sizeof(Word)) {
+            Word w;
+            memcpy(&w, p, sizeof(Word));
+            if (! isAsciiWord(w))
+                break;
+            for (unsigned int i = 0; i < sizeof(Word); i++)
+                out[i] = p[i];
+            out += sizeof(Word);
+            p += sizeof(Word);
+        }
+        if (p >= end)
+            break;
+
+        unsigned char c = *p;
+        if (! c)
+            break;
+        if (c < 0x80) {
+            *out++ = c;
+            p++;
+            continue;
+        }
+        
+        wchar_t wc = g_utf8_get_char_extended((const char*)p, end - p);
+        if (wc == (wchar_t)-2)      // partial character at end of input
+            break;
+        if (wc & 0x80000000)
+            throw Exception(L"Invalid byte sequence in conversion input");
+        *out++ = wc;
+        p += g_utf8_skip[c];
     }
-
-    std::wstring s(res);
-    free(res);
     
-    return s;
+    res.resize(out - res.data());
+    return res;
+}
+
+std::wstring fromUtf8(const std::string &str)
+{
+    return fromUtf8(str.data(), str.length());
 }
 
 
@@ -484,6 +347,19 @@ std::wstring fromUtf8(const std::string &str)
 }
 
 
+std::wstring fromUtf8(const char *str, int len)
+{
+    char *buf = (char*)malloc(len + 1);
+    if (! buf)
+        throw Exception(L"Error allocating memory");
+    memcpy(buf, str, len);
+    buf[len] = 0;
+    std::string s(buf);
+    free(buf);
+    return fromUtf8(s);
+}
+
+
 std::string toOem(const std::wstring &str)
 {
     if (! str.length())
@@ -518,19 +394,6 @@ std::wstring fromOem(const std::string &str)
 #endif
 
 
-std::wstring fromUtf8(const char *str, int len)
-{
-    char *buf = (char*)malloc(len + 1);
-    if (! buf)
-        throw Exception(L"Error allocating memory");
-    memcpy(buf, str, len);
-    buf[len] = 0;
-    std::string s(buf);
-    free(buf);
-    return fromUtf8(s);
-}
-
-
 std::string toMbcs(const std::wstring &str)
 {
     int len = str.length();
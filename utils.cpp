@@ -349,6 +349,15 @@ void ensureDirExists(const std::wstring &fileName)
 #endif
 }
 
+bool replaceFile(const std::string &from, const std::string &to)
+{
+#ifdef WIN32
+    // rename() fails on Windows if destination exists
+    remove(to.c_str());
+#endif
+    return ! rename(from.c_str(), to.c_str());
+}
+
 /*#else
 
 void ensureDirExists(const std::wstring &fileName)
@@ -31,6 +31,9 @@ void setPixel(SDL_Surface *s, int x, int y, int r, int g, int b);
 void drawBevel(SDL_Surface *s, int left, int top, int width, int height,
         bool raised, int size);
 void ensureDirExists(const std::wstring &fileName);
+
+/// Rename file replacing existing one.  Returns false on error.
+bool replaceFile(const std::string &from, const std::string &to);
 int readInt(std::istream &stream);
 std::wstring readString(std::istream &stream);
 void writeInt(std::ostream &stream, int value);
@@ -90,8 +90,8 @@ void VertHints::drawCell(int col, bool addToUpdate)
     if (r)
         r->draw(x, y, iconSet, highlighted == col);
     else {
-        screen.draw(x, y, iconSet.getEmptyHintIcon());
-        screen.draw(x, y + TILE_HEIGHT, iconSet.getEmptyHintIcon());
+        iconSet.draw(x, y, iconSet.getEmptyHintIcon());
+        iconSet.draw(x, y + TILE_HEIGHT, iconSet.getEmptyHintIcon());
     }
     
     if (addToUpdate)
@@ -171,6 +171,15 @@ int VertHints::getRuleNo(int x, int y)
     return no;
 }
 
+bool VertHints::getBounds(int &left, int &top, int &width, int &height)
+{
+    left = TILE_X;
+    top = TILE_Y;
+    width = (TILE_WIDTH + TILE_GAP) * TILE_NUM;
+    height = TILE_HEIGHT * 2;
+    return true;
+}
+
 bool VertHints::isActive(int ruleNo)
 {
     if ((ruleNo < 0) || (ruleNo >= (int)rules.size()))
@@ -31,6 +31,7 @@ class VertHints: public Widget
         void toggleExcluded();
         int getRuleNo(int x, int y);
         virtual bool onMouseMove(int x, int y);
+        virtual bool getBounds(int &left, int &top, int &width, int &height);
         bool isActive(int ruleNo);
         void save(std::ostream &stream);
         void reset(Rules &rules);
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "widgets.h"
 #include "main.h"
 #include "utils.h"
@@ -160,12 +161,13 @@ void Button::draw()
 }
 
 
-void Button::getBounds(int &l, int &t, int &w, int &h)
+bool Button::getBounds(int &l, int &t, int &w, int &h)
 {
     l = left;
     t = top;
     w = width;
     h = height;
+    return true;
 }
 
 
@@ -224,9 +226,15 @@ bool KeyAccel::onKeyDown(SDLKey k, unsigned char ch)
 //////////////////////////////////////////////////////////////////
 
 
+// size of hit-testing grid cell in pixels
+#define GRID_CELL_SIZE 32
+
+
 Area::Area()
 {
     timer = NULL;
+    gridCols = gridRows = 0;
+    indexValid = false;
 }
 
 Area::~Area()
@@ -244,35 +252,127 @@ void Area::add(Widget *widget, bool managed)
     if (! managed)
         notManagedWidgets.insert(widget);
     widget->setParent(this);
+    indexValid = false;
 }
 
 void Area::remove(Widget *widget)
 {
     widgets.remove(widget);
     notManagedWidgets.insert(widget);
+    indexValid = false;
+}
+
+void Area::buildIndex()
+{
+    indexedWidgets.clear();
+    unboundedWidgets.clear();
+    gridCols = (screen.getWidth() + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE;
+    gridRows = (screen.getHeight() + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE;
+    grid.assign(gridCols * gridRows, IndexList());
+
+    int no = 0;
+    for (WidgetsList::iterator i = widgets.begin(); i != widgets.end(); 
+            i++, no++) 
+    {
+        Widget *w = *i;
+        indexedWidgets.push_back(w);
+        int left, top, width, height;
+        if (! w->getBounds(left, top, width, height)) {
+            unboundedWidgets.push_back(no);
+            continue;
+        }
+        if ((width <= 0) || (height <= 0))
+            continue;
+        int startCol = left / GRID_CELL_SIZE;
+        int endCol = (left + width - 1) / GRID_CELL_SIZE;
+        int startRow = top / GRID_CELL_SIZE;
+        int endRow = (top + height - 1) / GRID_CELL_SIZE;
+        if (startCol < 0) startCol = 0;
+        if (startRow < 0) startRow = 0;
+        if (endCol >= gridCols) endCol = gridCols - 1;
+        if (endRow >= gridRows) endRow = gridRows - 1;
+        for (int row = startRow; row <= endRow; row++)
+            for (int col = startCol; col <= endCol; col++)
+                grid[row * gridCols + col].push_back(no);
+    }
+
+    int x, y;
+    SDL_GetMouseState(&x, &y);
+    hovered.clear();
+    getWidgetsAt(x, y, hovered);
+
+    indexValid = true;
+}
+
+void Area::getWidgetsAt(int x, int y, IndexList &list)
+{
+    int col = x / GRID_CELL_SIZE;
+    int row = y / GRID_CELL_SIZE;
+    if ((x < 0) || (y < 0) || (col >= gridCols) || (row >= gridRows))
+        return;
+    
+    IndexList &cell = grid[row * gridCols + col];
+    for (IndexList::iterator i = cell.begin(); i != cell.end(); i++) {
+        int left, top, width, height;
+        indexedWidgets[*i]->getBounds(left, top, width, height);
+        if (isInRect(x, y, left, top, width, height))
+            list.push_back(*i);
+    }
+}
+
+void Area::handleMouseEvent(const SDL_Event &event)
+{
+    if (! indexValid)
+        buildIndex();
+
+    int x, y;
+    if (SDL_MOUSEMOTION == event.type) {
+        x = event.motion.x;
+        y = event.motion.y;
+    } else {
+        x = event.button.x;
+        y = event.button.y;
+    }
+
+    IndexList underCursor;
+    getWidgetsAt(x, y, underCursor);
+
+    // widgets that was under cursor should know that mouse left them
+    IndexList targets(unboundedWidgets);
+    targets.insert(targets.end(), underCursor.begin(), underCursor.end());
+    if (SDL_MOUSEMOTION == event.type) {
+        targets.insert(targets.end(), hovered.begin(), hovered.end());
+        hovered = underCursor;
+    }
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+    for (IndexList::iterator i = targets.begin(); i != targets.end(); i++) {
+        Widget *w = indexedWidgets[*i];
+        bool processed;
+        switch (event.type) {
+            case SDL_MOUSEBUTTONDOWN:
+                processed = w->onMouseButtonDown(event.button.button, x, y);
+                break;
+            case SDL_MOUSEBUTTONUP:
+                processed = w->onMouseButtonUp(event.button.button, x, y);
+                break;
+            default:
+                processed = w->onMouseMove(x, y);
+        }
+        // stop if event is processed or widgets list is changed by handler
+        if (processed || (! indexValid))
+            return;
+    }
 }
 
 void Area::handleEvent(const SDL_Event &event)
 {
     switch (event.type) {
         case SDL_MOUSEBUTTONDOWN:
-            for (WidgetsList::iterator i = widgets.begin(); i != widgets.end(); i++)
-                if ((*i)->onMouseButtonDown(event.button.button, 
-                            event.button.x, event.button.y))
-                    return;
-            break;
-        
         case SDL_MOUSEBUTTONUP:
-            for (WidgetsList::iterator i = widgets.begin(); i != widgets.end(); i++)
-                if ((*i)->onMouseButtonUp(event.button.button, 
-                            event.button.x, event.button.y))
-                    return;
-            break;
-        
         case SDL_MOUSEMOTION:
-            for (WidgetsList::iterator i = widgets.begin(); i != widgets.end(); i++)
-                if ((*i)->onMouseMove(event.motion.x, event.motion.y))
-                    return;
+            handleMouseEvent(event);
             break;
         
         case SDL_VIDEOEXPOSE:
@@ -361,6 +461,13 @@ void Area::updateMouse()
     int x, y;
     SDL_GetMouseState(&x, &y);
     
+    // widgets state may be outdated after modal dialog,
+    // so all widgets are notified here
+    if (! indexValid)
+        buildIndex();
+    hovered.clear();
+    getWidgetsAt(x, y, hovered);
+    
     for (WidgetsList::iterator i = widgets.begin(); i != widgets.end(); i++)
         if ((*i)->onMouseMove(x, y))
                     return;
@@ -368,6 +475,56 @@ void Area::updateMouse()
 
 
 
+//////////////////////////////////////////////////////////////////
+//
+// StaticLayer
+//
+//////////////////////////////////////////////////////////////////
+
+
+StaticLayer::~StaticLayer()
+{
+    if (cache)
+        SDL_FreeSurface(cache);
+}
+
+void StaticLayer::draw()
+{
+    if (! cache) {
+        render();
+        cache = screen.createSubimage(0, 0, screen.getWidth(), 
+                screen.getHeight());
+    } else
+        screen.draw(0, 0, cache);
+    screen.addRegionToUpdate(0, 0, screen.getWidth(), screen.getHeight());
+}
+
+
+//////////////////////////////////////////////////////////////////
+//
+// ScreenSnapshot
+//
+//////////////////////////////////////////////////////////////////
+
+
+ScreenSnapshot::ScreenSnapshot()
+{
+    image = screen.createSubimage(0, 0, screen.getWidth(), 
+            screen.getHeight());
+}
+
+ScreenSnapshot::~ScreenSnapshot()
+{
+    SDL_FreeSurface(image);
+}
+
+void ScreenSnapshot::restore()
+{
+    screen.draw(0, 0, image);
+    screen.addRegionToUpdate(0, 0, screen.getWidth(), screen.getHeight());
+}
+
+
 //////////////////////////////////////////////////////////////////
 //
 // AnyKeyAccel
@@ -777,12 +934,13 @@ void Checkbox::draw()
 }
 
 
-void Checkbox::getBounds(int &l, int &t, int &w, int &h)
+bool Checkbox::getBounds(int &l, int &t, int &w, int &h)
 {
     l = left;
     t = top;
     w = width;
     h = height;
+    return true;
 }
 
 
@@ -852,12 +1010,13 @@ void Picture::moveX(const int newX)
     left = newX; 
 }
 
-void Picture::getBounds(int &l, int &t, int &w, int &h)
+bool Picture::getBounds(int &l, int &t, int &w, int &h)
 {
     l = left;
     t = top;
     w = width;
     h = height;
+    return true;
 }
 
 
@@ -4,6 +4,7 @@
 #include <string>
 #include <list>
 #include <set>
+#include <vector>
 #include <SDL/SDL.h>
 #include "font.h"
 
@@ -35,6 +36,12 @@ class Widget
         virtual void setParent(Area *a) { area = a; };
         virtual bool onKeyDown(SDLKey key, unsigned char ch) { return false; };
         virtual bool destroyByArea() { return true; };
+
+        /// Get rectangle which receives mouse events.  Widgets without
+        /// bounds receive every mouse event of their area.
+        virtual bool getBounds(int &left, int &top, int &width, int &height) {
+            return false;
+        };
 };
 
 
@@ -62,7 +69,7 @@ class Button: public Widget
 
     public:
         virtual void draw();
-        void getBounds(int &left, int &top, int &width, int &height);
+        virtual bool getBounds(int &left, int &top, int &width, int &height);
         int getLeft() const { return left; };
         int getTop() const { return top; };
         int getWidth() const { return width; };
@@ -104,6 +111,17 @@ class Area: public Widget
         Uint32 time;
         TimerHandler *timer;
 
+        // Mouse hit-testing index.  Widgets are referenced by their
+        // position in the widgets list, so sorted index lists keep
+        // the order of event dispatching.
+        typedef std::vector<int> IndexList;
+        std::vector<Widget*> indexedWidgets;
+        IndexList unboundedWidgets;      // widgets without bounds
+        std::vector<IndexList> grid;     // widgets overlapping grid cell
+        int gridCols, gridRows;
+        IndexList hovered;               // widgets under mouse cursor
+        bool indexValid;
+
     public:
         Area();
         virtual ~Area();
@@ -118,6 +136,48 @@ class Area: public Widget
         void setTimer(Uint32 interval, TimerHandler *handler);
         void updateMouse();
         virtual bool destroyByArea() { return false; };
+
+    private:
+        void buildIndex();
+        void getWidgetsAt(int x, int y, IndexList &list);
+        void handleMouseEvent(const SDL_Event &event);
+};
+
+
+/// Static full screen layer such as wallpaper with titles.
+/// Layer is rendered once and then drawn from cached surface.
+class StaticLayer: public Widget
+{
+    private:
+        SDL_Surface *cache;
+
+    public:
+        StaticLayer() { cache = NULL; };
+        virtual ~StaticLayer();
+
+    public:
+        virtual void draw();
+
+    protected:
+        /// Render layer directly to screen.
+        virtual void render() = 0;
+};
+
+
+/// Copy of screen contents taken before modal dialog.
+/// Restoring it repaints everything below the dialog with single blit.
+class ScreenSnapshot
+{
+    private:
+        SDL_Surface *image;
+
+    public:
+        ScreenSnapshot();
+        ~ScreenSnapshot();
+
+    public:
+        /// Draw saved screen contents back.
+        void restore();
 };
 
 
@@ -251,7 +311,7 @@ class Checkbox: public Widget
 
     public:
         virtual void draw();
-        void getBounds(int &left, int &top, int &width, int &height);
+        virtual bool getBounds(int &left, int &top, int &width, int &height);
         int getLeft() const { return left; };
         int getTop() const { return top; };
         int getWidth() const { return width; };
@@ -279,7 +339,7 @@ class Picture: public Widget
     public:
         virtual void draw();
         void moveX(const int newX);
-        void getBounds(int &l, int &t, int &w, int &h);
+        virtual bool getBounds(int &l, int &t, int &w, int &h);
         int getLeft() const { return left; };
         int getTop() const { return top; };
         int getWidth() const { return width; };